@@ -0,0 +1,95 @@
+// Copyright (C) 2014-2015 Jonathan Müller <jonathanmueller.dev@gmail.com>
+// This file is subject to the license terms in the LICENSE file
+// found in the top-level directory of this distribution.
+
+#include "corpus.hpp"
+
+#include <fstream>
+#include <unordered_set>
+#include <utility>
+
+#include "hash.hpp"
+
+namespace sid = foonathan::string_id;
+
+namespace
+{
+    std::vector<bench::entry>       strings;
+    std::unordered_set<std::string> unique;
+
+    void add(std::string str)
+    {
+        if (str.empty() || !unique.insert(str).second)
+            return;
+        bench::entry e{std::move(str), 0u, 0u};
+        sid::detail::sid_hash(e.str.c_str(), e.str.size(), e.hash);
+        sid::detail::sid_hash(e.str.c_str(), e.str.size(), e.hash64);
+        strings.push_back(std::move(e));
+    }
+
+    const char* const dirs[]     = {"textures", "meshes", "materials", "audio", "animations", "levels", "ui", "fx"};
+    const char* const groups[]   = {"characters", "props", "environment", "weapons", "vehicles", "common"};
+    const char* const names[]    = {"hero", "enemy", "tree", "rock", "door", "crate", "sword", "barrel",
+                                    "torch", "wall", "floor", "banner", "lamp", "chest", "bridge", "cliff"};
+    const char* const variants[] = {"diffuse", "normal", "roughness", "lod0", "lod1", "idle", "walk", "hit"};
+
+    template <std::size_t N>
+    const char* pick(const char* const (&array)[N], std::uint64_t& state)
+    {
+        state = state * 6364136223846793005u + 1442695040888963407u;
+        return array[(state >> 33) % N];
+    }
+
+    // e.g. textures/props/barrel_roughness_1f3.png
+    std::string generate(std::size_t i)
+    {
+        auto state = std::uint64_t(i) * 0x9E3779B97F4A7C15u;
+        std::string result = pick(dirs, state);
+        result += '/';
+        result += pick(groups, state);
+        result += '/';
+        result += pick(names, state);
+        result += '_';
+        result += pick(variants, state);
+        result += '_';
+
+        // makes the string unique
+        char number[16];
+        auto end = number + sizeof(number);
+        auto cur = end;
+        do
+        {
+            *--cur = "0123456789abcdefghijklmnopqrstuvwxyz"[i % 36u];
+            i /= 36u;
+        } while (i != 0u);
+        result.append(cur, end);
+        result += ".asset";
+        return result;
+    }
+} // namespace
+
+bool bench::load_corpus(const char* path)
+{
+    std::ifstream in(path);
+    if (!in)
+        return false;
+    for (std::string line; std::getline(in, line);)
+    {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        add(std::move(line));
+    }
+    return true;
+}
+
+const std::vector<bench::entry>& bench::corpus(std::size_t n)
+{
+    static std::size_t next = 0u;
+    if (strings.size() < n)
+    {
+        strings.reserve(n);
+        while (strings.size() != n)
+            add(generate(next++));
+    }
+    return strings;
+}
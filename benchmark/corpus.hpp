@@ -0,0 +1,32 @@
+// Copyright (C) 2014-2015 Jonathan Müller <jonathanmueller.dev@gmail.com>
+// This file is subject to the license terms in the LICENSE file
+// found in the top-level directory of this distribution.
+
+#ifndef FOONATHAN_STRING_ID_BENCHMARK_CORPUS_HPP_INCLUDED
+#define FOONATHAN_STRING_ID_BENCHMARK_CORPUS_HPP_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace bench
+{
+    struct entry
+    {
+        std::string   str;
+        std::uint32_t hash;
+        std::uint64_t hash64;
+    };
+
+    // loads one string per line, they are used before the generated ones
+    // must be called before the first call to corpus()
+    // returns false if the file can't be read
+    bool load_corpus(const char* path);
+
+    // returns n distinct strings, they look like paths of assets
+    // the same strings are shared by all benchmarks
+    const std::vector<entry>& corpus(std::size_t n);
+} // namespace bench
+
+#endif // FOONATHAN_STRING_ID_BENCHMARK_CORPUS_HPP_INCLUDED
@@ -0,0 +1,190 @@
+// Copyright (C) 2014-2015 Jonathan Müller <jonathanmueller.dev@gmail.com>
+// This file is subject to the license terms in the LICENSE file
+// found in the top-level directory of this distribution.
+
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "corpus.hpp"
+#include "database.hpp"
+#include "flat_database.hpp"
+
+namespace sid = foonathan::string_id;
+
+namespace
+{
+    // the database that was used before map_database for comparison
+    class unordered_map_database
+    {
+    public:
+        sid::insert_status insert(std::uint32_t hash, const char* str, std::size_t length)
+        {
+            auto result = map_.emplace(hash, std::string(str, length));
+            if (result.second)
+                return sid::insert_status::new_string;
+            return result.first->second.compare(0, std::string::npos, str, length) == 0 ? sid::insert_status::old_string
+                                                                                        : sid::insert_status::collision;
+        }
+
+        const char* lookup(std::uint32_t hash) const
+        {
+            auto iter = map_.find(hash);
+            return iter == map_.end() ? nullptr : iter->second.c_str();
+        }
+
+    private:
+        std::unordered_map<std::uint32_t, std::string> map_;
+    };
+
+    typedef sid::thread_safe_database<sid::map_database<uint32_t>, std::shared_mutex> shared_mutex_database;
+    typedef sid::sharded_database<sid::map_database<uint32_t>, 16>                    sharded_map_database;
+
+    template <class Database>
+    void fill(Database& db, std::size_t n)
+    {
+        auto& strings = bench::corpus(n);
+        for (auto i = 0u; i != n; ++i)
+            db.insert(strings[i].hash, strings[i].str.c_str(), strings[i].str.size());
+    }
+
+    // database shared by the threads of one multi-threaded benchmark
+    template <class Database>
+    std::unique_ptr<Database> shared_db;
+
+    template <class Database>
+    void setup_shared(const benchmark::State& state)
+    {
+        shared_db<Database>.reset(new Database);
+        fill(*shared_db<Database>, static_cast<std::size_t>(state.range(0)));
+    }
+
+    template <class Database>
+    void teardown_shared(const benchmark::State&)
+    {
+        shared_db<Database>.reset();
+    }
+
+    template <class Database>
+    void insert(benchmark::State& state)
+    {
+        auto  n       = static_cast<std::size_t>(state.range(0));
+        auto& strings = bench::corpus(n);
+        for (auto _ : state)
+        {
+            Database db;
+            for (auto i = 0u; i != n; ++i)
+                benchmark::DoNotOptimize(db.insert(strings[i].hash, strings[i].str.c_str(), strings[i].str.size()));
+        }
+        state.SetItemsProcessed(state.iterations() * n);
+    }
+
+    template <class Database>
+    void lookup(benchmark::State& state)
+    {
+        auto     n       = static_cast<std::size_t>(state.range(0));
+        auto&    strings = bench::corpus(n);
+        Database db;
+        fill(db, n);
+
+        // visit the strings in a different order than inserted
+        auto i = 0u;
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(db.lookup(strings[i].hash));
+            i = (i + 7919u) % n;
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    // resolving many ids at once, e.g. when serializing
+    template <class Database>
+    void lookup_batch(benchmark::State& state)
+    {
+        static constexpr std::size_t batch_size = 1024u;
+
+        auto     n       = static_cast<std::size_t>(state.range(0));
+        auto&    strings = bench::corpus(n);
+        Database db;
+        fill(db, n);
+
+        std::vector<std::uint32_t> hashes;
+        for (std::size_t i = 0u, j = 0u; i != batch_size; ++i, j = (j + 7919u) % n)
+            hashes.push_back(strings[j].hash);
+        std::vector<const char*> strs(batch_size);
+        for (auto _ : state)
+        {
+            db.lookup_batch(hashes, strs);
+            benchmark::DoNotOptimize(strs.data());
+        }
+        state.SetItemsProcessed(state.iterations() * batch_size);
+    }
+
+    // inserting a string that is already stored, i.e. the cost of the collision check
+    // this is what happens for most ids created at runtime
+    template <class Database>
+    void insert_existing(benchmark::State& state)
+    {
+        auto  n       = static_cast<std::size_t>(state.range(0));
+        auto& strings = bench::corpus(n);
+        auto& db      = *shared_db<Database>;
+
+        auto i = static_cast<std::size_t>(state.thread_index()) * 7919u % n;
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(db.insert(strings[i].hash, strings[i].str.c_str(), strings[i].str.size()));
+            i = (i + 7919u) % n;
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    template <class Database>
+    void shared_lookup(benchmark::State& state)
+    {
+        auto  n       = static_cast<std::size_t>(state.range(0));
+        auto& strings = bench::corpus(n);
+        auto& db      = *shared_db<Database>;
+
+        auto i = static_cast<std::size_t>(state.thread_index()) * 7919u % n;
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(db.lookup(strings[i].hash));
+            i = (i + 7919u) % n;
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+} // namespace
+
+#define FOONATHAN_STRING_ID_DATABASE_BENCHMARK(Database)                                     \
+    BENCHMARK_TEMPLATE(insert, Database)->Arg(10000)->Arg(1000000)->Arg(10000000)            \
+        ->Unit(benchmark::kMillisecond);                                                     \
+    BENCHMARK_TEMPLATE(lookup, Database)->Arg(10000)->Arg(1000000)->Arg(10000000)
+
+#define FOONATHAN_STRING_ID_SHARED_BENCHMARK(Function, Database)                             \
+    BENCHMARK_TEMPLATE(Function, Database)->Arg(10000)->Arg(1000000)                         \
+        ->Setup(setup_shared<Database>)->Teardown(teardown_shared<Database>)
+
+#define FOONATHAN_STRING_ID_THREADED_BENCHMARK(Database)                                     \
+    FOONATHAN_STRING_ID_DATABASE_BENCHMARK(Database);                                        \
+    FOONATHAN_STRING_ID_SHARED_BENCHMARK(insert_existing, Database)                          \
+        ->ThreadRange(1, 16)->UseRealTime();                                                 \
+    FOONATHAN_STRING_ID_SHARED_BENCHMARK(shared_lookup, Database)->ThreadRange(1, 16)->UseRealTime()
+
+FOONATHAN_STRING_ID_DATABASE_BENCHMARK(unordered_map_database);
+FOONATHAN_STRING_ID_DATABASE_BENCHMARK(sid::map_database<uint32_t>);
+FOONATHAN_STRING_ID_DATABASE_BENCHMARK(sid::flat_database<uint32_t>);
+BENCHMARK_TEMPLATE(lookup_batch, sid::map_database<uint32_t>)->Arg(10000)->Arg(1000000)->Arg(10000000);
+BENCHMARK_TEMPLATE(lookup_batch, sid::flat_database<uint32_t>)->Arg(10000)->Arg(1000000)->Arg(10000000);
+FOONATHAN_STRING_ID_SHARED_BENCHMARK(insert_existing, unordered_map_database);
+FOONATHAN_STRING_ID_SHARED_BENCHMARK(insert_existing, sid::map_database<uint32_t>);
+FOONATHAN_STRING_ID_SHARED_BENCHMARK(insert_existing, sid::flat_database<uint32_t>);
+FOONATHAN_STRING_ID_SHARED_BENCHMARK(insert_existing, sid::dummy_database<uint32_t>);
+
+FOONATHAN_STRING_ID_THREADED_BENCHMARK(sid::thread_safe_database<sid::map_database<uint32_t>>);
+FOONATHAN_STRING_ID_THREADED_BENCHMARK(shared_mutex_database);
+FOONATHAN_STRING_ID_THREADED_BENCHMARK(sharded_map_database);
+FOONATHAN_STRING_ID_THREADED_BENCHMARK(sid::concurrent_map_database<uint32_t>);
@@ -0,0 +1,91 @@
+// Copyright (C) 2014-2015 Jonathan Müller <jonathanmueller.dev@gmail.com>
+// This file is subject to the license terms in the LICENSE file
+// found in the top-level directory of this distribution.
+
+#include <iterator>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "database.hpp"
+#include "generator.hpp"
+#include "registered_database.hpp"
+
+namespace sid = foonathan::string_id;
+
+namespace
+{
+    // each benchmark run uses a new database so the strings of previous runs don't accumulate
+    typedef sid::registered_database<sid::sharded_database<sid::map_database<std::uint64_t>, 16>> database;
+    typedef sid::string_id<database, std::uint64_t> id;
+
+    template <class Generator>
+    struct shared_generator
+    {
+        database  db;
+        Generator generator;
+
+        template <typename... Args>
+        shared_generator(Args&&... args)
+        : db(), generator(id(db, "asset_"), std::forward<Args>(args)...) {}
+    };
+
+    // generator shared by the threads of one multi-threaded benchmark
+    template <class Generator>
+    std::unique_ptr<shared_generator<Generator>> shared;
+
+    template <class Generator>
+    void setup_shared(const benchmark::State&)
+    {
+        shared<Generator>.reset(new shared_generator<Generator>);
+    }
+
+    template <class Generator>
+    void teardown_shared(const benchmark::State&)
+    {
+        shared<Generator>.reset();
+    }
+
+    template <class Generator>
+    void generate(benchmark::State& state)
+    {
+        auto& generator = shared<Generator>->generator;
+        for (auto _ : state)
+            benchmark::DoNotOptimize(generator());
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    template <class Generator>
+    void generate_n(benchmark::State& state)
+    {
+        auto&           generator = shared<Generator>->generator;
+        auto            n         = static_cast<std::size_t>(state.range(0));
+        std::vector<id> ids;
+        ids.reserve(n);
+        for (auto _ : state)
+        {
+            ids.clear();
+            generator.generate_n(std::back_inserter(ids), n);
+            benchmark::DoNotOptimize(ids.data());
+        }
+        state.SetItemsProcessed(state.iterations() * n);
+    }
+
+    typedef sid::counter_generator<id>                  counter_generator;
+    typedef sid::random_generator<id, std::mt19937, 12> random_generator;
+    typedef sid::per_thread_random_generator<id, 12>    per_thread_random_generator;
+} // namespace
+
+#define FOONATHAN_STRING_ID_GENERATOR_BENCHMARK(Function, Generator)                         \
+    BENCHMARK_TEMPLATE(Function, Generator)                                                  \
+        ->Setup(setup_shared<Generator>)->Teardown(teardown_shared<Generator>)
+
+// the random generator isn't thread safe
+FOONATHAN_STRING_ID_GENERATOR_BENCHMARK(generate, counter_generator)->ThreadRange(1, 16)->UseRealTime();
+FOONATHAN_STRING_ID_GENERATOR_BENCHMARK(generate, random_generator);
+FOONATHAN_STRING_ID_GENERATOR_BENCHMARK(generate, per_thread_random_generator)->ThreadRange(1, 16)->UseRealTime();
+FOONATHAN_STRING_ID_GENERATOR_BENCHMARK(generate_n, counter_generator)->Arg(1000)->ThreadRange(1, 16)->UseRealTime();
+FOONATHAN_STRING_ID_GENERATOR_BENCHMARK(generate_n, random_generator)->Arg(1000);
+FOONATHAN_STRING_ID_GENERATOR_BENCHMARK(generate_n, per_thread_random_generator)->Arg(1000)->ThreadRange(1, 16)->UseRealTime();
@@ -0,0 +1,39 @@
+// Copyright (C) 2014-2015 Jonathan Müller <jonathanmueller.dev@gmail.com>
+// This file is subject to the license terms in the LICENSE file
+// found in the top-level directory of this distribution.
+
+#include <cstdint>
+#include <string>
+
+#include <benchmark/benchmark.h>
+
+#include "hash.hpp"
+
+namespace sid = foonathan::string_id;
+
+namespace
+{
+    template <class HashPolicy, typename T>
+    void hash(benchmark::State& state)
+    {
+        auto        length = static_cast<std::size_t>(state.range(0));
+        std::string str(length, 'a');
+        for (std::size_t i = 0u; i != length; ++i)
+            str[i] = static_cast<char>('a' + (i * 7u) % 26u);
+
+        for (auto _ : state)
+        {
+            benchmark::DoNotOptimize(str.data());
+            benchmark::DoNotOptimize(HashPolicy::template fast_hash<T>(str.data(), str.size()));
+        }
+        state.SetBytesProcessed(state.iterations() * std::int64_t(length));
+    }
+} // namespace
+
+#define FOONATHAN_STRING_ID_HASH_BENCHMARK(Policy, T) \
+    BENCHMARK_TEMPLATE(hash, Policy, T)->RangeMultiplier(4)->Range(4, 4096)
+
+FOONATHAN_STRING_ID_HASH_BENCHMARK(sid::fnv1a_policy, std::uint32_t);
+FOONATHAN_STRING_ID_HASH_BENCHMARK(sid::fnv1a_policy, std::uint64_t);
+FOONATHAN_STRING_ID_HASH_BENCHMARK(sid::xxh3_policy, std::uint64_t);
+FOONATHAN_STRING_ID_HASH_BENCHMARK(sid::wyhash_policy, std::uint64_t);
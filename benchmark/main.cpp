@@ -0,0 +1,35 @@
+// Copyright (C) 2014-2015 Jonathan Müller <jonathanmueller.dev@gmail.com>
+// This file is subject to the license terms in the LICENSE file
+// found in the top-level directory of this distribution.
+
+#include <cstdio>
+#include <cstring>
+
+#include <benchmark/benchmark.h>
+
+#include "corpus.hpp"
+
+// usage: foonathan_string_id_bench [--corpus=<file>] [benchmark options]
+// e.g. --benchmark_out=result.json --benchmark_out_format=json for results that can be tracked
+int main(int argc, char* argv[])
+{
+    static const char corpus_arg[] = "--corpus=";
+    auto                out        = 1;
+    for (auto i = 1; i != argc; ++i)
+    {
+        if (std::strncmp(argv[i], corpus_arg, sizeof(corpus_arg) - 1) != 0)
+            argv[out++] = argv[i];
+        else if (!bench::load_corpus(argv[i] + sizeof(corpus_arg) - 1))
+        {
+            std::fprintf(stderr, "unable to read corpus '%s'\n", argv[i] + sizeof(corpus_arg) - 1);
+            return 1;
+        }
+    }
+    argc = out;
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv))
+        return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+}
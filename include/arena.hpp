@@ -0,0 +1,71 @@
+// Copyright (C) 2014-2015 Jonathan Müller <jonathanmueller.dev@gmail.com>
+// This file is subject to the license terms in the LICENSE file
+// found in the top-level directory of this distribution.
+
+#ifndef FOONATHAN_STRING_ID_ARENA_HPP_INCLUDED
+#define FOONATHAN_STRING_ID_ARENA_HPP_INCLUDED
+
+#include <cstddef>
+
+#include "config.hpp"
+
+namespace foonathan { namespace string_id
+{
+    /// \brief A memory arena that carves memory out of big blocks.
+    /// \detail Allocation just bumps a pointer, the memory is only released all at once in the destructor.<br>
+    /// It is the default arena type of \ref map_database.
+    /// A custom arena must provide the same \c allocate() function
+    /// and the memory must stay valid until the arena is destroyed.
+    class memory_arena
+    {
+    public:
+        /// \brief The default size of each memory block.
+        static FOONATHAN_CONSTEXPR std::size_t default_block_size = 64 * 1024u;
+
+        /// \brief Creates a new arena, it allocates memory blocks of given size.
+        /// \detail The first block is allocated lazily.
+        explicit memory_arena(std::size_t block_size = default_block_size) FOONATHAN_NOEXCEPT;
+
+        memory_arena(memory_arena&& other) FOONATHAN_NOEXCEPT;
+
+        ~memory_arena() FOONATHAN_NOEXCEPT;
+
+        memory_arena& operator=(memory_arena&& other) FOONATHAN_NOEXCEPT;
+
+        /// \brief Returns memory of given size and alignment.
+        /// \detail Requests bigger than the block size get a block on their own.
+        /// \throws \c std::bad_alloc if the allocation fails.
+        void* allocate(std::size_t size, std::size_t alignment);
+
+        /// \brief Makes sure the next allocations of \c size bytes in total do not need a new block.
+        /// \detail It allocates a new block of at least that size if the current one is too small.
+        /// This function is optional for custom arenas.
+        /// \throws \c std::bad_alloc if the allocation fails.
+        void reserve(std::size_t size);
+
+        /// \brief Returns the number of bytes that can be allocated without allocating a new block.
+        /// \detail Alignment padding is not taken into account.
+        std::size_t capacity() const FOONATHAN_NOEXCEPT
+        {
+            return std::size_t(end_ - cur_);
+        }
+
+        /// \brief Returns the number of memory blocks allocated.
+        std::size_t no_blocks() const FOONATHAN_NOEXCEPT
+        {
+            return no_blocks_;
+        }
+
+    private:
+        struct block;
+
+        void release() FOONATHAN_NOEXCEPT;
+        char* allocate_block(std::size_t size);
+
+        block*      head_;
+        char *      cur_, *end_;
+        std::size_t block_size_, no_blocks_;
+    };
+}} // namespace foonathan::string_id
+
+#endif // FOONATHAN_STRING_ID_ARENA_HPP_INCLUDED
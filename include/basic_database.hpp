@@ -7,10 +7,43 @@
 
 #include "config.hpp"
 #include "hash.hpp"
+#include <array>
+#include <atomic>
 #include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
 
 namespace foonathan { namespace string_id
 {
+    /// \brief Information about a string.
+    /// \detail It is used to reduce the number of constructors of \ref string_id.
+    struct string_info
+    {
+        /// \brief A pointer to a null-terminated string.
+        const char *string;
+        /// \brief The length of this string.
+        std::size_t length;
+        
+        /// \brief Creates it from a null-terminated string (implicit conversion).
+        string_info(const char *str) FOONATHAN_NOEXCEPT
+        : string(str), length(std::strlen(str)) {}
+        
+        /// \brief Creates it from a string with given length.
+        /// \arg \c str does not need to be null-terminated.
+        string_info(const char *str, std::size_t length)
+        : string(str), length(length) {}
+
+        /// \brief Creates it from a \c std::string_view (implicit conversion).
+        /// \detail The view does not need to be null-terminated, its length is used as is.
+        string_info(std::string_view str) FOONATHAN_NOEXCEPT
+        : string(str.data()), length(str.size()) {}
+    };
+    
     /// \brief The status of an insert operation.
     enum class insert_status : uint8_t
     {
@@ -22,8 +55,72 @@ namespace foonathan { namespace string_id
         old_string
     };
 
+    /// \brief How thoroughly an insert checks a stored string with the same hash.
+    enum class verify_level : uint8_t
+    {
+        /// \brief The string isn't inserted at all, the caller guarantees that it was inserted before.
+        /// \detail It is handled by \ref string_id, databases treat it like \c hash.
+        none = 0,
+        /// \brief A stored string with the same hash is assumed to be equal, collisions are not detected.
+        hash,
+        /// \brief The strings are compared to detect collisions, like \c basic_database::insert() does.
+        full
+    };
+
+    /// \brief Statistics about a database, returned by \c basic_database::stats().
+    /// \detail The counters of events are only updated if \ref FOONATHAN_STRING_ID_STATS is \c true,
+    /// otherwise they are \c 0. Members that don't apply to a database are \c 0 as well.
+    struct database_stats
+    {
+        /// \brief The number of chain lengths counted separately.
+        static FOONATHAN_CONSTEXPR std::size_t max_chain_length = 8u;
+
+        /// \brief The number of strings stored.
+        std::size_t no_items = 0u;
+        /// \brief The number of bytes used for the strings, including the null terminators.
+        std::size_t string_bytes = 0u;
+        /// \brief The number of buckets.
+        std::size_t no_buckets = 0u;
+        /// \brief \c chain_lengths[i] is the number of buckets with \c i strings,
+        /// the last entry counts all longer chains as well.
+        std::array<std::size_t, max_chain_length + 1u> chain_lengths = {};
+
+        /// \brief The number of calls to an insert function, each string of a batch counts.
+        std::uint64_t inserts = 0u;
+        /// \brief The number of calls to \c lookup().
+        std::uint64_t lookups = 0u;
+        /// \brief The number of inserts that returned \ref insert_status::collision.
+        std::uint64_t collisions = 0u;
+        /// \brief The number of times the table was resized.
+        std::uint64_t rehashes = 0u;
+        /// \brief The total time spent resizing.
+        std::chrono::nanoseconds rehash_time = {};
+        /// \brief The total time spent waiting for a lock.
+        std::chrono::nanoseconds lock_wait_time = {};
+
+        /// \brief Adds the statistics of another database, e.g. of another shard.
+        database_stats& operator+=(const database_stats& other) FOONATHAN_NOEXCEPT
+        {
+            no_items     += other.no_items;
+            string_bytes += other.string_bytes;
+            no_buckets   += other.no_buckets;
+            for (std::size_t i = 0u; i != chain_lengths.size(); ++i)
+                chain_lengths[i] += other.chain_lengths[i];
+            inserts        += other.inserts;
+            lookups        += other.lookups;
+            collisions     += other.collisions;
+            rehashes       += other.rehashes;
+            rehash_time    += other.rehash_time;
+            lock_wait_time += other.lock_wait_time;
+            return *this;
+        }
+    };
+
 	/// \brief The interface for all databases.
-    /// \detail You can derive own databases from it.
+    /// \detail You can derive own databases from it.<br>
+    /// A database whose \c lookup() doesn't return the stored strings but a placeholder
+    /// must declare a static member \c stores_strings that is \c false,
+    /// ids with a prefix then require an incremental hash policy.
     template<typename STORAGE_T>
     class basic_database
     {
@@ -58,6 +155,32 @@ namespace foonathan { namespace string_id
         /// \arg \c length is the length of the suffix.
         /// \return The \ref insert_status.
         virtual insert_status insert_prefix(STORAGE_T hash, STORAGE_T prefix, const char* str, std::size_t length);
+
+        /// \brief Inserts a hash-string-pair, checking a stored string with the same hash only as given.
+        /// \detail The default implementation always compares the strings by calling \ref insert.<br>
+        /// Override it if you can skip the comparison.
+        /// \arg \c level is the \ref verify_level, with anything but \c full
+        /// a stored string with the same hash results in \ref insert_status::old_string.
+        /// \return The \ref insert_status.
+        virtual insert_status insert_verify(STORAGE_T hash, const char* str, std::size_t length, verify_level level);
+
+        /// \brief Inserts multiple hash-string-pairs at once.
+        /// \detail The default implementation calls \ref insert for each string.<br>
+        /// Override it if you can do it more efficiently, e.g. by resizing or locking only once.
+        /// \arg \c hashes are the hashes of the strings.
+        /// \arg \c strs are the strings, same size as \c hashes.
+        /// \arg \c status receives the \ref insert_status of each string, same size as \c hashes.
+        virtual void insert_batch(std::span<const STORAGE_T> hashes, std::span<const string_info> strs,
+                                  std::span<insert_status> status);
+
+        /// \brief Inserts multiple strings with the same prefix at once.
+        /// \detail The default implementation calls \ref insert_prefix for each string.
+        /// \arg \c hashes are the hashes of the concatenated strings.
+        /// \arg \c prefix is the hash of the prefix, it was inserted before.
+        /// \arg \c strs are the suffixes, same size as \c hashes.
+        /// \arg \c status receives the \ref insert_status of each string, same size as \c hashes.
+        virtual void insert_prefix_batch(std::span<const STORAGE_T> hashes, STORAGE_T prefix,
+                                         std::span<const string_info> strs, std::span<insert_status> status);
         
         /// \brief Should return the string stored with a given hash.
         /// \detail It is guaranteed that the hash value has been inserted before.
@@ -65,11 +188,40 @@ namespace foonathan { namespace string_id
         /// an error message if the database does not store anything.<br>
         /// The return value must stay valid as long as the database exists.
         virtual const char* lookup(STORAGE_T hash) const FOONATHAN_NOEXCEPT = 0;
+
+        /// \brief Returns the string stored with a given hash together with its length.
+        /// \detail It is guaranteed that the hash value has been inserted before.
+        /// The default implementation calls \ref lookup and computes the length.<br>
+        /// Override it if the length is stored, so it does not need to be computed.
+        /// \return A view of the same null-terminated string \ref lookup returns, excluding the null terminator.
+        virtual std::string_view lookup_view(STORAGE_T hash) const FOONATHAN_NOEXCEPT;
+
+        /// \brief Returns the strings stored with multiple hashes at once.
+        /// \detail The default implementation calls \ref lookup for each hash.<br>
+        /// Override it if you can do it more efficiently, e.g. by prefetching or locking only once.
+        /// \arg \c hashes are the hashes, each one has been inserted before.
+        /// \arg \c strs receives the string \ref lookup would return for each hash, same size as \c hashes.
+        virtual void lookup_batch(std::span<const STORAGE_T> hashes, std::span<const char*> strs) const FOONATHAN_NOEXCEPT;
+
+        /// \brief Returns statistics about the database.
+        /// \detail The default implementation returns empty statistics.<br>
+        /// It may need to visit all strings, so it should not be called often.
+        virtual database_stats stats() const
+        {
+            return {};
+        }
         
     protected:
         basic_database() = default;
     };
 
+    // equivalent to std::string(str, length) == other_str
+    // other_str is null-terminated
+    inline bool strequal(const char* str, std::size_t length, const char* other_str) FOONATHAN_NOEXCEPT
+    {
+        return std::strncmp(str, other_str, length) == 0 && other_str[length] == '\0';
+    }
+
     // equivalent to prefix + str == other_str for std::string
     // prefix and other_str are null-terminated
     inline bool strequal(const char* prefix, const char* str, std::size_t length, const char* other_str) FOONATHAN_NOEXCEPT
@@ -81,12 +233,126 @@ namespace foonathan { namespace string_id
         return std::strncmp(str, other_str, length) == 0;
     }
 
+    namespace detail
+    {
+        // whether lookup() returns the stored strings, true unless the database says otherwise
+        template <class Database>
+        struct database_stores_strings : std::true_type {};
+
+        template <class Database>
+            requires requires { Database::stores_strings; }
+        struct database_stores_strings<Database> : std::bool_constant<Database::stores_strings> {};
+
+        // hint to fetch the cache line of ptr, only used for performance
+        inline void prefetch(const void* ptr) FOONATHAN_NOEXCEPT
+        {
+        #if defined(__GNUC__) || defined(__clang__)
+            __builtin_prefetch(ptr);
+        #else
+            (void)ptr;
+        #endif
+        }
+
+        // the counters of database_stats updated by the databases
+        // relaxed atomics, so they can be updated by concurrent lookups
+        class database_counters
+        {
+        public:
+        #if FOONATHAN_STRING_ID_STATS
+            void insert(insert_status status) FOONATHAN_NOEXCEPT
+            {
+                inserts_.fetch_add(1u, std::memory_order_relaxed);
+                if (status == insert_status::collision)
+                    collisions_.fetch_add(1u, std::memory_order_relaxed);
+            }
+
+            void lookup() FOONATHAN_NOEXCEPT
+            {
+                lookups_.fetch_add(1u, std::memory_order_relaxed);
+            }
+
+            void rehash(std::chrono::nanoseconds duration) FOONATHAN_NOEXCEPT
+            {
+                rehashes_.fetch_add(1u, std::memory_order_relaxed);
+                rehash_ns_.fetch_add(std::uint64_t(duration.count()), std::memory_order_relaxed);
+            }
+
+            void lock_wait(std::chrono::nanoseconds duration) FOONATHAN_NOEXCEPT
+            {
+                lock_wait_ns_.fetch_add(std::uint64_t(duration.count()), std::memory_order_relaxed);
+            }
+
+            void get(database_stats& stats) const FOONATHAN_NOEXCEPT
+            {
+                stats.inserts        += inserts_.load(std::memory_order_relaxed);
+                stats.lookups        += lookups_.load(std::memory_order_relaxed);
+                stats.collisions     += collisions_.load(std::memory_order_relaxed);
+                stats.rehashes       += rehashes_.load(std::memory_order_relaxed);
+                stats.rehash_time    += std::chrono::nanoseconds(rehash_ns_.load(std::memory_order_relaxed));
+                stats.lock_wait_time += std::chrono::nanoseconds(lock_wait_ns_.load(std::memory_order_relaxed));
+            }
+
+        private:
+            std::atomic<std::uint64_t> inserts_{0u}, lookups_{0u}, collisions_{0u},
+                                       rehashes_{0u}, rehash_ns_{0u}, lock_wait_ns_{0u};
+        #else
+            void insert(insert_status) FOONATHAN_NOEXCEPT {}
+            void lookup() FOONATHAN_NOEXCEPT {}
+            void rehash(std::chrono::nanoseconds) FOONATHAN_NOEXCEPT {}
+            void lock_wait(std::chrono::nanoseconds) FOONATHAN_NOEXCEPT {}
+            void get(database_stats&) const FOONATHAN_NOEXCEPT {}
+        #endif
+        };
+    } // namespace detail
+
     template<typename STORAGE_T>
     insert_status basic_database<STORAGE_T>::insert_prefix(
         STORAGE_T hash, STORAGE_T prefix, const char* str, std::size_t length)
     {
-        std::string prefix_str = lookup(prefix);
-        return insert(hash, (prefix_str + str).c_str(), prefix_str.size() + length);
+        std::string str_full(lookup_view(prefix));
+        str_full.append(str, length);
+        return insert(hash, str_full.c_str(), str_full.size());
+    }
+
+    template<typename STORAGE_T>
+    insert_status basic_database<STORAGE_T>::insert_verify(STORAGE_T hash, const char* str, std::size_t length,
+                                                           verify_level)
+    {
+        return insert(hash, str, length);
+    }
+
+    template<typename STORAGE_T>
+    std::string_view basic_database<STORAGE_T>::lookup_view(STORAGE_T hash) const FOONATHAN_NOEXCEPT
+    {
+        return lookup(hash);
+    }
+
+    template<typename STORAGE_T>
+    void basic_database<STORAGE_T>::lookup_batch(std::span<const STORAGE_T> hashes,
+                                                 std::span<const char*> strs) const FOONATHAN_NOEXCEPT
+    {
+        assert(hashes.size() == strs.size());
+        for (std::size_t i = 0u; i != hashes.size(); ++i)
+            strs[i] = lookup(hashes[i]);
+    }
+
+    template<typename STORAGE_T>
+    void basic_database<STORAGE_T>::insert_batch(std::span<const STORAGE_T> hashes, std::span<const string_info> strs,
+                                                 std::span<insert_status> status)
+    {
+        assert(hashes.size() == strs.size() && hashes.size() == status.size());
+        for (std::size_t i = 0u; i != hashes.size(); ++i)
+            status[i] = insert(hashes[i], strs[i].string, strs[i].length);
+    }
+
+    template<typename STORAGE_T>
+    void basic_database<STORAGE_T>::insert_prefix_batch(std::span<const STORAGE_T> hashes, STORAGE_T prefix,
+                                                        std::span<const string_info> strs,
+                                                        std::span<insert_status> status)
+    {
+        assert(hashes.size() == strs.size() && hashes.size() == status.size());
+        for (std::size_t i = 0u; i != hashes.size(); ++i)
+            status[i] = insert_prefix(hashes[i], prefix, strs[i].string, strs[i].length);
     }
 
 
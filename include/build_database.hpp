@@ -0,0 +1,246 @@
+// Copyright (C) 2014-2015 Jonathan Müller <jonathanmueller.dev@gmail.com>
+// This file is subject to the license terms in the LICENSE file
+// found in the top-level directory of this distribution.
+
+#ifndef FOONATHAN_STRING_ID_BUILD_DATABASE_HPP_INCLUDED
+#define FOONATHAN_STRING_ID_BUILD_DATABASE_HPP_INCLUDED
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "basic_database.hpp"
+#include "config.hpp"
+#include "database.hpp"
+#include "error.hpp"
+#include "mapped_database.hpp"
+
+namespace foonathan { namespace string_id
+{
+    /// \brief An executor that runs the tasks on up to a given number of threads.
+    /// \detail It is the default executor of \ref build_database() and the parallel \ref write_snapshot().<br>
+    /// A custom executor, e.g. for a thread pool, must provide \c concurrency() returning the number of tasks
+    /// that can run in parallel and \c operator()(no_tasks, f) that calls \c f(i) for each \c i less than \c no_tasks
+    /// in parallel and returns after all of them have finished.
+    /// The library never passes more tasks than \c concurrency().
+    class thread_executor
+    {
+    public:
+        /// \brief Creates it giving the maximum number of threads, \c 0 means the number of cores.
+        explicit thread_executor(std::size_t no_threads = 0u) FOONATHAN_NOEXCEPT
+        : no_threads_(no_threads ? no_threads : std::max(std::thread::hardware_concurrency(), 1u)) {}
+
+        std::size_t concurrency() const FOONATHAN_NOEXCEPT
+        {
+            return no_threads_;
+        }
+
+        /// \detail At most \c concurrency() threads run the tasks, one of them is the calling thread.
+        /// Each thread runs the next task that hasn't been started until all are done.
+        /// If a task throws, the exception is rethrown after all tasks have finished.
+        template <typename Func>
+        void operator()(std::size_t no_tasks, Func f) const
+        {
+            std::vector<std::exception_ptr> errors(no_tasks);
+            std::atomic<std::size_t> next_task(0u);
+            auto run = [&]
+            {
+                for (auto i = next_task++; i < no_tasks; i = next_task++)
+                    try
+                    {
+                        f(i);
+                    }
+                    catch (...)
+                    {
+                        errors[i] = std::current_exception();
+                    }
+            };
+
+            auto no_threads = std::min(no_threads_, no_tasks);
+            std::vector<std::thread> threads;
+            threads.reserve(no_threads);
+            for (std::size_t i = 1u; i < no_threads; ++i)
+                threads.emplace_back(run);
+            run();
+            for (auto& t : threads)
+                t.join();
+
+            for (auto& e : errors)
+                if (e)
+                    std::rethrow_exception(e);
+        }
+
+    private:
+        std::size_t no_threads_;
+    };
+
+    /// \cond impl
+    namespace detail
+    {
+        // fewer strings aren't worth an own task
+        FOONATHAN_CONSTEXPR inline std::size_t build_min_task_size = 4096u;
+
+        // calls f(begin, end) for disjoint ranges covering [0, size) in parallel
+        template <class Executor, typename Func>
+        void parallel_ranges(Executor& exec, std::size_t size, Func f)
+        {
+            auto no_tasks = std::min(exec.concurrency(), (size + build_min_task_size - 1) / build_min_task_size);
+            if (no_tasks <= 1u)
+            {
+                f(std::size_t(0u), size);
+                return;
+            }
+            exec(no_tasks, [&](std::size_t i) { f(size * i / no_tasks, size * (i + 1) / no_tasks); });
+        }
+
+        template <typename STORAGE_T, class HashPolicy, class Executor>
+        void parallel_hash(Executor& exec, std::span<const string_info> strs, std::span<STORAGE_T> hashes)
+        {
+            parallel_ranges(exec, strs.size(), [&](std::size_t begin, std::size_t end)
+            {
+                for (auto i = begin; i != end; ++i)
+                    hashes[i] = HashPolicy::template fast_hash<STORAGE_T>(strs[i].string, strs[i].length);
+            });
+        }
+
+        // reorders the indices of the strings so that each partition is contiguous
+        // returns the start of each partition, followed by the total size
+        template <typename STORAGE_T>
+        std::vector<std::size_t> partition_indices(std::span<const STORAGE_T> hashes, std::size_t no_bits,
+                                                   std::vector<std::size_t>& indices)
+        {
+            std::vector<std::size_t> begin((std::size_t(1) << no_bits) + 1u);
+            indices.resize(hashes.size());
+            partition_indices(hashes, no_bits, indices.data(), begin.data());
+            return begin;
+        }
+
+        template <class Database, typename STORAGE_T>
+        std::size_t handle_build_status(Database& db, std::span<const STORAGE_T> hashes,
+                                        std::span<const string_info> strs, std::span<const insert_status> status)
+        {
+            std::size_t no_new = 0u;
+            for (std::size_t i = 0u; i != status.size(); ++i)
+                if (status[i] == insert_status::new_string)
+                    ++no_new;
+                else if (status[i] == insert_status::collision)
+                    get_collision_handler<STORAGE_T>()(hashes[i], std::string(strs[i].string, strs[i].length).c_str(),
+                                                       db.Database::lookup(hashes[i]));
+            return no_new;
+        }
+    } // namespace detail
+    /// \endcond
+
+    /// \brief Inserts many strings into a database, using multiple threads.
+    /// \detail The strings are hashed in parallel with \c HashPolicy,
+    /// it must be the same as the one of the \ref string_id using the database.<br>
+    /// For a \ref sharded_database, the strings are partitioned by shard
+    /// and each shard is filled with a single \c insert_batch() call by one of \c concurrency() tasks,
+    /// so there is no contention between the tasks.
+    /// Other databases are reserved for all strings, if possible, and get them via a single \c insert_batch() call.<br>
+    /// The database must not be used by other threads meanwhile.
+    /// For two different strings with the same hash the \ref collision_handler is called.
+    /// \return The number of strings that were new.
+    template <class HashPolicy = default_hash_policy, class Database, class Executor = thread_executor>
+    std::size_t build_database(Database& db, std::span<const string_info> strs, Executor&& exec = Executor())
+    {
+        typedef typename Database::STORAGE_TYPE storage_type;
+
+        std::vector<storage_type> hashes(strs.size());
+        detail::parallel_hash<storage_type, HashPolicy>(exec, strs, std::span<storage_type>(hashes));
+
+        std::vector<insert_status> status(strs.size());
+        if constexpr (requires { Database::shard_index(storage_type()); })
+        {
+            if (strs.size() < detail::build_min_task_size)
+            {
+                db.Database::insert_batch(hashes, strs, status);
+                return detail::handle_build_status(db, std::span<const storage_type>(hashes), strs,
+                                                   std::span<const insert_status>(status));
+            }
+
+            std::size_t no_bits = 0u;
+            while ((std::size_t(1) << no_bits) < Database::no_shards())
+                ++no_bits;
+            std::vector<std::size_t> indices;
+            auto begin = detail::partition_indices(std::span<const storage_type>(hashes), no_bits, indices);
+
+            std::vector<storage_type>  shard_hashes(strs.size());
+            std::vector<string_info>   shard_strs(strs.begin(), strs.end());
+            std::vector<insert_status> shard_status(strs.size());
+            for (std::size_t i = 0u; i != indices.size(); ++i)
+            {
+                shard_hashes[i] = hashes[indices[i]];
+                shard_strs[i]   = strs[indices[i]];
+            }
+
+            auto no_tasks = std::max(std::min(Database::no_shards(), exec.concurrency()), std::size_t(1u));
+            exec(no_tasks, [&](std::size_t task)
+            {
+                for (auto shard = task; shard < Database::no_shards(); shard += no_tasks)
+                {
+                    auto b = begin[shard], size = begin[shard + 1u] - b;
+                    db.insert_batch(shard, std::span<const storage_type>(shard_hashes.data() + b, size),
+                                    std::span<const string_info>(shard_strs.data() + b, size),
+                                    std::span<insert_status>(shard_status.data() + b, size));
+                }
+            });
+            for (std::size_t i = 0u; i != indices.size(); ++i)
+                status[indices[i]] = shard_status[i];
+        }
+        else
+        {
+            if constexpr (requires(std::size_t n) { db.reserve(n, n); db.size(); })
+            {
+                std::size_t no_bytes = 0u;
+                for (auto& str : strs)
+                    no_bytes += str.length;
+                db.reserve(db.size() + strs.size(), no_bytes);
+            }
+            db.Database::insert_batch(hashes, strs, status);
+        }
+
+        return detail::handle_build_status(db, std::span<const storage_type>(hashes), strs,
+                                           std::span<const insert_status>(status));
+    }
+
+    /// \brief Writes a snapshot file like the other \ref write_snapshot() but uses multiple threads.
+    /// \detail The strings are hashed in parallel, partitioned by the highest bits of their hash
+    /// and each partition is sorted by an own task.
+    /// \return The number of strings written.
+    /// \throws \ref snapshot_error if the file can't be written.
+    template <typename STORAGE_T, class HashPolicy = default_hash_policy, class Executor>
+    std::size_t write_snapshot(const char* path, std::span<const string_info> strs, Executor&& exec)
+    {
+        std::vector<STORAGE_T> hashes(strs.size());
+        detail::parallel_hash<STORAGE_T, HashPolicy>(exec, strs, std::span<STORAGE_T>(hashes));
+
+        std::size_t no_bits = 0u;
+        while ((std::size_t(2) << no_bits) <= exec.concurrency() && no_bits < 8u
+               && (std::size_t(2) << no_bits) * detail::build_min_task_size <= strs.size())
+            ++no_bits;
+        std::vector<std::size_t> indices;
+        auto begin = detail::partition_indices(std::span<const STORAGE_T>(hashes), no_bits, indices);
+
+        std::vector<detail::snapshot_entry<STORAGE_T>> entries;
+        entries.reserve(strs.size());
+        for (auto i : indices)
+            entries.push_back({hashes[i], strs[i]});
+
+        exec(begin.size() - 1u, [&](std::size_t i)
+        {
+            std::sort(entries.begin() + begin[i], entries.begin() + begin[i + 1u],
+                      detail::snapshot_entry_less<STORAGE_T>);
+        });
+        return detail::write_snapshot<STORAGE_T>(path, entries);
+    }
+}} // namespace foonathan::string_id
+
+#endif // FOONATHAN_STRING_ID_BUILD_DATABASE_HPP_INCLUDED
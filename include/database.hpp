@@ -5,13 +5,30 @@
 #ifndef FOONATHAN_STRING_ID_DATABASE_HPP_INCLUDED
 #define FOONATHAN_STRING_ID_DATABASE_HPP_INCLUDED
 
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <climits>
 #include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <memory>
 #include <mutex>
+#include <new>
+#include <shared_mutex>
+#include <span>
 #include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
+#include "arena.hpp"
 #include "basic_database.hpp"
 #include "config.hpp"
+#include "error.hpp"
 
 namespace foonathan { namespace string_id
 {    
@@ -22,6 +39,8 @@ namespace foonathan { namespace string_id
     class dummy_database : public basic_database<STORAGE_T>
     {
     public:        
+        static FOONATHAN_CONSTEXPR bool stores_strings = false;
+
         insert_status insert(STORAGE_T, const char*, std::size_t) FOONATHAN_OVERRIDE
         {
             return insert_status::new_string;
@@ -31,6 +50,20 @@ namespace foonathan { namespace string_id
         {
             return insert_status::new_string;
         }
+
+        void insert_batch(std::span<const STORAGE_T>, std::span<const string_info>,
+                          std::span<insert_status> status) FOONATHAN_OVERRIDE
+        {
+            for (auto& s : status)
+                s = insert_status::new_string;
+        }
+
+        void insert_prefix_batch(std::span<const STORAGE_T>, STORAGE_T, std::span<const string_info>,
+                                 std::span<insert_status> status) FOONATHAN_OVERRIDE
+        {
+            for (auto& s : status)
+                s = insert_status::new_string;
+        }
         
         const char* lookup(STORAGE_T) const FOONATHAN_NOEXCEPT FOONATHAN_OVERRIDE
         {
@@ -38,37 +71,411 @@ namespace foonathan { namespace string_id
         }
     };
     
+    /// \brief Information about a rehash of a database.
+    struct rehash_info
+    {
+        /// \brief The number of buckets before and after the rehash.
+        std::size_t old_bucket_count, new_bucket_count;
+        /// \brief The number of strings stored in the database.
+        std::size_t no_items;
+        /// \brief The time it took to relink the strings.
+        std::chrono::nanoseconds duration;
+    };
+
+    /// \brief The type of the rehash handler.
+    /// \detail It will be called after a \ref map_database has been rehashed, giving information about it.
+    /// It is meant for instrumentation, e.g. to make sure no rehash happens after startup.<br>
+    /// There is no default handler, in this case the time isn't measured.
+    using rehash_handler = void(*)(const rehash_info& info);
+
+    /// \brief Exchanges the \ref rehash_handler, \c nullptr disables it.
+    /// \detail For an incremental rehash it is called when the rehash starts,
+    /// the duration is then the time it took to allocate the new buckets.<br>
+    /// This function is thread safe if \ref FOONATHAN_STRING_ID_ATOMIC_HANDLER is \c true.
+    inline rehash_handler set_rehash_handler(rehash_handler h);
+
+    /// \brief Returns the current \ref rehash_handler.
+    inline rehash_handler get_rehash_handler();
+
+    /// \cond impl
+    namespace detail
+    {
+        // serializes the materialization of shared strings in lookup(), does nothing if none are shared
+        template <bool SharePrefixes>
+        struct materialize_mutex
+        {
+            void lock() FOONATHAN_NOEXCEPT {}
+            void unlock() FOONATHAN_NOEXCEPT {}
+        };
+
+        template <>
+        struct materialize_mutex<true> : std::mutex {};
+
+        // the targets of the references of nodes sharing their prefix, the prefix nodes and the materialized strings
+        // a reference is a 32 bit index into it instead of a pointer, so short prefixes can be shared as well
+        // it is empty if no prefixes are shared
+        template <bool SharePrefixes>
+        class ref_table
+        {
+        public:
+            template <class Arena>
+            bool share(Arena&, const void*, std::uint32_t&) FOONATHAN_NOEXCEPT
+            {
+                return false;
+            }
+
+            template <class Arena>
+            std::uint32_t add(Arena&, const void*) FOONATHAN_NOEXCEPT
+            {
+                assert(false && "no prefixes are shared");
+                return 0u;
+            }
+
+            const void* operator[](std::uint32_t) const FOONATHAN_NOEXCEPT
+            {
+                assert(false && "no prefixes are shared");
+                return nullptr;
+            }
+        };
+
+        // entries are only added by inserts or by lookups holding the materialize mutex and they never move,
+        // so an entry can be read without a lock once the reference to it was published
+        template <>
+        class ref_table<true>
+        {
+        public:
+            // the lowest bit of a reference tells whether it is a prefix node, the others are the index
+            static FOONATHAN_CONSTEXPR std::size_t max_size = std::size_t(1u) << 31;
+
+            ref_table() FOONATHAN_NOEXCEPT : segments_(), size_(0u), reserved_(0u) {}
+
+            // gets the index of the prefix node, adding it if necessary,
+            // and reserves the entry for the materialized string of the node sharing it
+            // returns false if the table is full, the prefix must be copied then
+            template <class Arena>
+            bool share(Arena& arena, const void* prefix, std::uint32_t& index)
+            {
+                auto iter = prefixes_.find(prefix);
+                if (reserved_ + (iter == prefixes_.end() ? 2u : 1u) > max_size)
+                    return false;
+                else if (iter == prefixes_.end())
+                {
+                    ++reserved_;
+                    index = add(arena, prefix);
+                    prefixes_.emplace(prefix, index);
+                }
+                else
+                    index = iter->second;
+                ++reserved_;
+                return true;
+            }
+
+            // adds an entry that has been reserved, returns its index
+            template <class Arena>
+            std::uint32_t add(Arena& arena, const void* ptr)
+            {
+                assert(size_ < reserved_ && "entry not reserved");
+                auto  pos     = size_ + first_segment;
+                auto  segment = std::bit_width(pos) - first_segment_bits - 1u;
+                auto& entries = segments_[segment];
+                if (!entries)
+                    entries = static_cast<const void**>(
+                        arena.allocate((first_segment << segment) * sizeof(const void*), alignof(const void*)));
+                entries[pos - (first_segment << segment)] = ptr;
+                return static_cast<std::uint32_t>(size_++);
+            }
+
+            const void* operator[](std::uint32_t index) const FOONATHAN_NOEXCEPT
+            {
+                auto pos     = std::size_t(index) + first_segment;
+                auto segment = std::bit_width(pos) - first_segment_bits - 1u;
+                return segments_[segment][pos - (first_segment << segment)];
+            }
+
+        private:
+            // segment i has first_segment << i entries
+            static FOONATHAN_CONSTEXPR std::size_t first_segment_bits = 4u;
+            static FOONATHAN_CONSTEXPR std::size_t first_segment      = std::size_t(1u) << first_segment_bits;
+            static FOONATHAN_CONSTEXPR std::size_t no_segments        = 32u - first_segment_bits;
+
+            const void** segments_[no_segments];
+            std::size_t  size_, reserved_;
+            std::unordered_map<const void*, std::uint32_t> prefixes_;
+        };
+
+        inline std::size_t round_up_pow2(std::size_t v) FOONATHAN_NOEXCEPT
+        {
+            std::size_t res = 1u;
+            while (res < v)
+                res <<= 1;
+            return res;
+        }
+
+        FOONATHAN_CONSTEXPR inline std::size_t cache_line_size = 64u;
+
+        struct cache_aligned_delete
+        {
+            void operator()(void* ptr) const FOONATHAN_NOEXCEPT
+            {
+                ::operator delete(ptr, std::align_val_t(cache_line_size));
+            }
+        };
+
+        template <typename T>
+        using cache_aligned_array = std::unique_ptr<T[], cache_aligned_delete>;
+
+        // value-initialized array starting at a cache line, so no element is split between two lines
+        template <typename T>
+        cache_aligned_array<T> make_cache_aligned(std::size_t size)
+        {
+            static_assert(std::is_trivially_destructible_v<T> && std::is_nothrow_default_constructible_v<T>,
+                          "elements are never destroyed");
+            auto mem = static_cast<T*>(::operator new(size * sizeof(T), std::align_val_t(cache_line_size)));
+            std::uninitialized_value_construct_n(mem, size);
+            return cache_aligned_array<T>(mem);
+        }
+    } // namespace detail
+    /// \endcond
+
+    /// \brief The exception class thrown by \ref map_database if a string is too long to be stored.
+    /// \detail It doesn't allocate memory.
+    class string_length_error : public error
+    {
+    public:
+        //=== constructor/destructor ===//
+        /// \brief Creates it by giving it the length of the string and the maximum length supported.
+        string_length_error(std::size_t length, std::size_t max_length) FOONATHAN_NOEXCEPT;
+
+        ~string_length_error() FOONATHAN_NOEXCEPT FOONATHAN_OVERRIDE {}
+
+        //=== accessors ===//
+        const char* what() const FOONATHAN_NOEXCEPT FOONATHAN_OVERRIDE;
+
+        /// \brief Returns the length of the string.
+        std::size_t length() const FOONATHAN_NOEXCEPT
+        {
+            return length_;
+        }
+
+        /// \brief Returns the maximum length supported.
+        std::size_t max_length() const FOONATHAN_NOEXCEPT
+        {
+            return max_length_;
+        }
+
+    private:
+        std::size_t length_, max_length_;
+        char what_[128];
+    };
+
     /// \brief A database that uses a highly optimized hash table.
-    template<typename STORAGE_T>
+    /// \detail The nodes are allocated from an arena of type \c Arena, see \ref memory_arena.
+    /// They are never freed individually, the arena releases them all at once when the database is destroyed.<br>
+    /// If \c StoreStrings is \c false, only a 64 bit fingerprint of each string is stored to detect collisions,
+    /// \c lookup() then returns "string_id database does not store strings".<br>
+    /// If \c SharePrefixes is \c true, a string inserted via \c insert_prefix() stores a 32 bit reference to the node
+    /// of its prefix followed by the suffix instead of a copy of the prefix, if the prefix is longer than four characters.
+    /// The references are indices into a table that stores each prefix node once.
+    /// The full string is then created on the first \c lookup() and kept in addition to the suffix
+    /// until the database is destroyed, so after a lookup the string takes more memory than without sharing.
+    /// If the arena can't allocate it, \c lookup() returns "string_id database out of memory" instead.<br>
+    /// A string must be shorter than 2^31 characters, inserting a longer one throws \ref string_length_error.<br>
+    /// The number of buckets is always a power of two, so a bucket is selected by masking the hash,
+    /// and the bucket array starts at a cache line.
+    template<typename STORAGE_T, class Arena = memory_arena, bool StoreStrings = true, bool SharePrefixes = false>
     class map_database : public basic_database<STORAGE_T>
     {
     public:        
+        /// \brief The type of the arena the nodes are allocated from.
+        typedef Arena arena_type;
+
+        /// \brief Whether or not \c lookup() returns the stored strings.
+        static FOONATHAN_CONSTEXPR bool stores_strings = StoreStrings;
+
         /// \brief Creates a new database with given number of buckets and maximum load factor.
-        explicit map_database(std::size_t size = 1024, double max_load_factor = 1.0);
+        /// \detail The number of buckets is rounded up to the next power of two.
+        /// The nodes will be allocated from the given arena.
+        explicit map_database(std::size_t size = 1024, double max_load_factor = 1.0,
+                              arena_type arena = arena_type());
         ~map_database() FOONATHAN_NOEXCEPT;
         
         insert_status insert(STORAGE_T hash, const char* str, std::size_t length) FOONATHAN_OVERRIDE;
         insert_status insert_prefix(STORAGE_T hash, STORAGE_T prefix, const char* str, std::size_t length) FOONATHAN_OVERRIDE;
+        insert_status insert_verify(STORAGE_T hash, const char* str, std::size_t length,
+                                    verify_level level) FOONATHAN_OVERRIDE;
+
+        /// \brief Inserts multiple strings at once.
+        /// \detail It resizes the table at most once and prefetches the buckets.
+        void insert_batch(std::span<const STORAGE_T> hashes, std::span<const string_info> strs,
+                          std::span<insert_status> status) FOONATHAN_OVERRIDE;
+
+        /// \brief Inserts multiple strings with the same prefix at once.
+        /// \detail It resizes the table at most once and prefetches the buckets.
+        void insert_prefix_batch(std::span<const STORAGE_T> hashes, STORAGE_T prefix,
+                                 std::span<const string_info> strs, std::span<insert_status> status) FOONATHAN_OVERRIDE;
+
         const char* lookup(STORAGE_T hash) const FOONATHAN_NOEXCEPT FOONATHAN_OVERRIDE;
+
+        /// \brief Returns the string together with its length, which is stored in the node.
+        std::string_view lookup_view(STORAGE_T hash) const FOONATHAN_NOEXCEPT FOONATHAN_OVERRIDE;
+
+        /// \brief Returns the strings of multiple hashes at once.
+        /// \detail The buckets and then the first node of each bucket are prefetched ahead,
+        /// so the cache misses of following lookups overlap instead of being paid one after another.
+        void lookup_batch(std::span<const STORAGE_T> hashes, std::span<const char*> strs) const FOONATHAN_NOEXCEPT FOONATHAN_OVERRIDE;
+
+        /// \brief Returns the statistics, it visits all strings for the chain lengths.
+        database_stats stats() const FOONATHAN_OVERRIDE;
+
+        //=== capacity ===//
+        /// \brief Prepares the database for storing given number of strings in total.
+        /// \detail Afterwards inserting that many strings does not rehash.
+        /// If the arena supports it, memory for \c no_bytes characters is reserved as well,
+        /// so no further blocks need to be allocated.
+        /// \arg \c no_strings is the total number of strings, including the ones already inserted.
+        /// \arg \c no_bytes is the total length of the strings that will be inserted.
+        void reserve(std::size_t no_strings, std::size_t no_bytes = 0u);
+
+        /// \brief Reduces the number of buckets as much as possible without exceeding the maximum load factor.
+        void shrink_to_fit();
+
+        /// \brief Returns the number of buckets.
+        std::size_t bucket_count() const FOONATHAN_NOEXCEPT
+        {
+            return no_buckets_;
+        }
+
+        /// \brief Returns the number of strings stored.
+        std::size_t size() const FOONATHAN_NOEXCEPT
+        {
+            return no_items_;
+        }
+
+        /// \brief Returns the average number of strings per bucket.
+        double load_factor() const FOONATHAN_NOEXCEPT
+        {
+            return double(no_items_) / no_buckets_;
+        }
+
+        /// \brief Returns the load factor that causes a rehash when reached.
+        double max_load_factor() const FOONATHAN_NOEXCEPT
+        {
+            return max_load_factor_;
+        }
+
+        //=== incremental rehashing ===//
+        /// \brief Enables or disables incremental rehashing.
+        /// \detail If enabled, a rehash triggered by an insert only allocates the new buckets,
+        /// the old ones are kept and each following insert moves \c buckets_per_insert of them,
+        /// so the cost of rehashing is spread over many inserts.
+        /// If that isn't enough to move all of them before the next rehash is due,
+        /// e.g. for a small \c buckets_per_insert or a maximum load factor below \c 1,
+        /// each insert moves as many as needed for that instead.
+        /// Lookups search the bucket the string currently is in and don't move any.<br>
+        /// \c reserve() and \c shrink_to_fit() still rehash completely.
+        /// \arg \c buckets_per_insert is the number of buckets moved per insert, \c 0 disables it.
+        void set_incremental_rehash(std::size_t buckets_per_insert) FOONATHAN_NOEXCEPT
+        {
+            rehash_step_ = buckets_per_insert;
+        }
+
+        /// \brief Returns whether or not an incremental rehash is in progress.
+        bool is_rehashing() const FOONATHAN_NOEXCEPT
+        {
+            return bool(old_buckets_);
+        }
         
     private:        
-        void rehash();
-        
         class node_list;
-        std::unique_ptr<node_list[]> buckets_;
+
+        node_list& bucket(STORAGE_T hash) const FOONATHAN_NOEXCEPT;
+
+        std::size_t grown_size(std::size_t no_new) const FOONATHAN_NOEXCEPT;
+        void grow(std::size_t no_new);
+        void rehash(std::size_t new_size);
+        void start_rehash(std::size_t new_size);
+        void migrate(std::size_t no_buckets) FOONATHAN_NOEXCEPT;
+        
+        mutable arena_type arena_; // lookup() materializes shared strings
+        detail::cache_aligned_array<node_list> buckets_;
         std::size_t no_items_, no_buckets_;
         double max_load_factor_;
         std::size_t next_resize_;
+        // buckets not yet moved by an incremental rehash, all below migrate_pos_ are empty
+        detail::cache_aligned_array<node_list> old_buckets_;
+        std::size_t no_old_buckets_, migrate_pos_, rehash_step_, migrate_step_;
+        [[no_unique_address]] mutable detail::database_counters counters_;
+        [[no_unique_address]] mutable detail::materialize_mutex<SharePrefixes> materialize_mutex_;
+        [[no_unique_address]] mutable detail::ref_table<SharePrefixes> refs_;
     };
     
+    /// \cond impl
+    namespace detail
+    {
+        // the highest bits select the partition, like the shard of a sharded_database
+        template <typename STORAGE_T>
+        FOONATHAN_CONSTEXPR_FNC std::size_t hash_partition(STORAGE_T hash, std::size_t no_bits) FOONATHAN_NOEXCEPT
+        {
+            return no_bits ? std::size_t(hash >> (sizeof(STORAGE_T) * CHAR_BIT - no_bits)) : 0u;
+        }
+
+        // reorders the indices of the hashes via counting sort so that each partition is contiguous
+        // begin receives the start of each of the 2^no_bits partitions, followed by the total size
+        template <typename STORAGE_T>
+        void partition_indices(std::span<const STORAGE_T> hashes, std::size_t no_bits,
+                               std::size_t* indices, std::size_t* begin) FOONATHAN_NOEXCEPT
+        {
+            auto no_partitions = std::size_t(1) << no_bits;
+            std::fill(begin, begin + no_partitions + 1u, std::size_t(0u));
+            for (auto hash : hashes)
+                ++begin[hash_partition(hash, no_bits) + 1u];
+            for (std::size_t i = 1u; i != no_partitions + 1u; ++i)
+                begin[i] += begin[i - 1u];
+
+            // begin[p] is advanced to the end of partition p, i.e. the start of p + 1
+            for (std::size_t i = 0u; i != hashes.size(); ++i)
+                indices[begin[hash_partition(hashes[i], no_bits)]++] = i;
+            for (auto i = no_partitions; i != 0u; --i)
+                begin[i] = begin[i - 1u];
+            begin[0] = 0u;
+        }
+
+        // locks the mutex, only measures the time if it is already locked
+        template <class Mutex, class Lock = std::unique_lock<Mutex>>
+        Lock lock_counted(Mutex& mutex, database_counters& counters)
+        {
+        #if FOONATHAN_STRING_ID_STATS
+            Lock lock(mutex, std::try_to_lock);
+            if (!lock.owns_lock())
+            {
+                auto start = std::chrono::steady_clock::now();
+                lock.lock();
+                counters.lock_wait(std::chrono::steady_clock::now() - start);
+            }
+            return lock;
+        #else
+            (void)counters;
+            return Lock(mutex);
+        #endif
+        }
+    } // namespace detail
+    /// \endcond
+
     /// \brief A thread-safe database adapter.
-    /// \detail It derives from any database type and synchronizes access via \c std::mutex.
-    template <class Database>
+    /// \detail It derives from any database type and synchronizes access via a mutex of type \c Mutex.
+    /// If it provides \c lock_shared() like \c std::shared_mutex, \c lookup() only takes a shared lock,
+    /// so lookups of multiple threads don't block each other, only inserts are exclusive.
+    /// This requires that concurrent calls to \c lookup() of the base database are safe,
+    /// which is the case for all databases of this library.
+    template <class Database, class Mutex = std::mutex>
     class thread_safe_database : public Database
     {
     public:
         /// \brief The base database.
         typedef Database base_database;
+
+        /// \brief The type of the mutex.
+        typedef Mutex mutex_type;
         
         // workaround of lacking inheriting constructors
 		template <typename ... Args>
@@ -77,258 +484,1607 @@ namespace foonathan { namespace string_id
         
         insert_status insert(base_database::STORAGE_TYPE hash, const char* str, std::size_t length) FOONATHAN_OVERRIDE
         {
-            std::lock_guard<std::mutex> lock(mutex_);
+            auto lock = lock_mutex();
             return Database::insert(hash, str, length);
         }
         
         insert_status insert_prefix(base_database::STORAGE_TYPE hash, base_database::STORAGE_TYPE prefix, const char* str, std::size_t length) FOONATHAN_OVERRIDE
         {
-            std::lock_guard<std::mutex> lock(mutex_);
+            auto lock = lock_mutex();
             return Database::insert_prefix(hash, prefix, str, length);
         }
+
+        insert_status insert_verify(base_database::STORAGE_TYPE hash, const char* str, std::size_t length,
+                                    verify_level level) FOONATHAN_OVERRIDE
+        {
+            auto lock = lock_mutex();
+            return Database::insert_verify(hash, str, length, level);
+        }
+
+        void insert_batch(std::span<const typename base_database::STORAGE_TYPE> hashes, std::span<const string_info> strs,
+                          std::span<insert_status> status) FOONATHAN_OVERRIDE
+        {
+            auto lock = lock_mutex();
+            Database::insert_batch(hashes, strs, status);
+        }
+
+        void insert_prefix_batch(std::span<const typename base_database::STORAGE_TYPE> hashes,
+                                 typename base_database::STORAGE_TYPE prefix, std::span<const string_info> strs,
+                                 std::span<insert_status> status) FOONATHAN_OVERRIDE
+        {
+            auto lock = lock_mutex();
+            Database::insert_prefix_batch(hashes, prefix, strs, status);
+        }
         
         const char* lookup(base_database::STORAGE_TYPE hash) const FOONATHAN_NOEXCEPT FOONATHAN_OVERRIDE
         {
-            std::lock_guard<std::mutex> lock(mutex_);
+            auto lock = lock_shared();
             return Database::lookup(hash);
         }
-        
-    private:
-        mutable std::mutex mutex_;
-    };
 
-    /// \cond impl
-    template <typename STORAGE_T>
-    class map_database<STORAGE_T>::node_list
-    {
-        struct node
+        std::string_view lookup_view(base_database::STORAGE_TYPE hash) const FOONATHAN_NOEXCEPT FOONATHAN_OVERRIDE
         {
-            std::size_t length; // length of string
-            STORAGE_T   hash;
-            node*       next;
-
-            node(const char* str, std::size_t length, STORAGE_T h, node* next) FOONATHAN_NOEXCEPT
-            : length(length),
-              hash(h),
-              next(next)
-            {
-                void* mem  = this;
-                auto  dest = static_cast<char*>(mem) + sizeof(node);
-                strncpy(dest, str, length);
-                dest[length] = 0;
-            }
+            auto lock = lock_shared();
+            return Database::lookup_view(hash);
+        }
 
-            node(const char* prefix, std::size_t length_prefix, const char* str,
-                 std::size_t length_string, STORAGE_T h, node* next) FOONATHAN_NOEXCEPT
-            : length(length_prefix + length_string),
-              hash(h),
-              next(next)
-            {
-                void* mem  = this;
-                auto  dest = static_cast<char*>(mem) + sizeof(node);
-                strncpy(dest, prefix, length_prefix);
-                dest += length_prefix;
-                strncpy(dest, str, length_string);
-                dest[length_string] = 0;
-            }
+        void lookup_batch(std::span<const typename base_database::STORAGE_TYPE> hashes,
+                          std::span<const char*> strs) const FOONATHAN_NOEXCEPT FOONATHAN_OVERRIDE
+        {
+            auto lock = lock_shared();
+            Database::lookup_batch(hashes, strs);
+        }
 
-            const char* get_str() const FOONATHAN_NOEXCEPT
+        /// \brief Returns the statistics of the base database including the time waiting for the mutex.
+        database_stats stats() const FOONATHAN_OVERRIDE
+        {
+            database_stats result;
             {
-                const void* mem = this;
-                return static_cast<const char*>(mem) + sizeof(node);
+                auto lock = lock_shared();
+                result    = Database::stats();
             }
-        };
+            counters_.get(result);
+            return result;
+        }
+        
+    private:
+        std::unique_lock<Mutex> lock_mutex() const
+        {
+            return detail::lock_counted(mutex_, counters_);
+        }
 
-        struct insert_pos_t
+        auto lock_shared() const
         {
-            bool exists; // if true: cur set, else: prev and next set
+            if constexpr (requires(Mutex& m) { m.lock_shared(); })
+                return detail::lock_counted<Mutex, std::shared_lock<Mutex>>(mutex_, counters_);
+            else
+                return lock_mutex();
+        }
 
-            node*& prev;
-            node*  next;
+        mutable Mutex mutex_;
+        [[no_unique_address]] mutable detail::database_counters counters_;
+    };
 
-            node* cur;
+    /// \brief A thread-safe database adapter that splits the strings into multiple shards.
+    /// \detail Each shard is an own database of type \c Database protected by an own \c std::mutex.
+    /// The shard is selected by the highest bits of the hash value,
+    /// so threads only contend if they access the same shard.
+    /// \c N is the number of shards and must be a power of two.
+    template <class Database, std::size_t N>
+    class sharded_database : public basic_database<typename Database::STORAGE_TYPE>
+    {
+        static_assert(N != 0u && (N & (N - 1)) == 0u, "number of shards must be a power of two");
 
-            insert_pos_t(node*& prev, node* next) FOONATHAN_NOEXCEPT 
-                : exists(false),
-                  prev(prev),
-                  next(next),
-                  cur(nullptr)
-            {}
+    public:
+        /// \brief The database type of each shard.
+        typedef Database base_database;
 
-            insert_pos_t(node* cur) FOONATHAN_NOEXCEPT 
-                : exists(true),
-                  prev(this->cur),
-                  next(nullptr),
-                  cur(cur)
-            {}
-        };
+        static FOONATHAN_CONSTEXPR bool stores_strings = detail::database_stores_strings<Database>::value;
 
-    public:
-        node_list() FOONATHAN_NOEXCEPT : head_(nullptr) {}
+        using STORAGE_TYPE = typename base_database::STORAGE_TYPE;
 
-        ~node_list() FOONATHAN_NOEXCEPT
+        /// \brief Creates all shards, each one is constructed with the given arguments.
+        template <typename... Args>
+        explicit sharded_database(const Args&... args)
         {
-            auto cur = head_;
-            while (cur)
-            {
-                auto next = cur->next;
-                cur->~node();
-                // researched: no memory leak is expected here
-                // https://stackoverflow.com/questions/39648970/does-operator-delete-void-know-the-size-of-memory-allocated-with-operat
-                // https://stackoverflow.com/questions/6783993/placement-new-and-delete
-                ::operator delete(cur);
-                cur = next;
-            }
+            for (auto& s : shards_)
+                s.db.reset(new base_database(args...));
         }
 
-        insert_status insert(STORAGE_T hash, const char* str, std::size_t length)
+        insert_status insert(STORAGE_TYPE hash, const char* str, std::size_t length) FOONATHAN_OVERRIDE
         {
-            auto pos = insert_pos(hash);
-            if (pos.exists)
-                return std::strncmp(str, pos.cur->get_str(), length) == 0 ? insert_status::old_string
-                                                                          : insert_status::collision;
-            auto mem = ::operator new(sizeof(node) + length + 1);
-            auto n   = ::new (mem) node(str, length, hash, pos.next);
-            pos.prev = n;
-            return insert_status::new_string;
+            auto& s = get_shard(hash);
+            auto lock = detail::lock_counted(s.mutex, s.counters);
+            return s.db->Database::insert(hash, str, length);
         }
 
-        insert_status insert_prefix(node_list& prefix_bucket, STORAGE_T prefix, STORAGE_T hash,
-                                         const char* str, std::size_t length)
+        insert_status insert_verify(STORAGE_TYPE hash, const char* str, std::size_t length,
+                                    verify_level level) FOONATHAN_OVERRIDE
         {
-            auto prefix_node = prefix_bucket.find_node(prefix);
-            auto pos         = insert_pos(hash);
-            if (pos.exists)
-                return strequal(prefix_node->get_str(), str, length, pos.cur->get_str())
-                           ? insert_status::old_string
-                           : insert_status::collision;
-            auto mem = ::operator new(sizeof(node) + prefix_node->length + length + 1);
-            auto n   = ::new (mem) node(prefix_node->get_str(), prefix_node->length, str, length, hash, pos.next);
-            pos.prev = n;
-            return insert_status::new_string;
+            auto& s = get_shard(hash);
+            auto lock = detail::lock_counted(s.mutex, s.counters);
+            return s.db->Database::insert_verify(hash, str, length, level);
         }
 
-        // inserts all nodes into new buckets, this list is empty afterwards
-        void rehash(node_list* buckets, std::size_t size) FOONATHAN_NOEXCEPT
+        insert_status insert_prefix(STORAGE_TYPE hash, STORAGE_TYPE prefix, const char* str, std::size_t length) FOONATHAN_OVERRIDE
         {
-            auto cur = head_;
-            while (cur)
+            auto& s = get_shard(hash);
+            auto& p = get_shard(prefix);
+            if (&s == &p)
             {
-                auto next = cur->next;
-                auto pos  = buckets[cur->hash % size].insert_pos(cur->hash);
-                assert(!pos.exists && "element can't be there already");
-                pos.prev  = cur;
-                cur->next = pos.next;
-                cur       = next;
+                auto lock = detail::lock_counted(s.mutex, s.counters);
+                return s.db->Database::insert_prefix(hash, prefix, str, length);
             }
-            head_ = nullptr;
-        }
 
-        // returns element with hash, there must be one
-        const char* lookup(STORAGE_T h) const FOONATHAN_NOEXCEPT
-        {
-            return find_node(h)->get_str();
+            std::string full;
+            {
+                auto lock = detail::lock_counted(p.mutex, p.counters);
+                full = p.db->Database::lookup_view(prefix);
+            }
+            full.append(str, length);
+            auto lock = detail::lock_counted(s.mutex, s.counters);
+            return s.db->Database::insert(hash, full.c_str(), full.size());
         }
 
-    private:
-        node* find_node(STORAGE_T h) const FOONATHAN_NOEXCEPT
+        /// \brief Inserts multiple strings at once.
+        /// \detail The strings are grouped by shard in a single counting pass, each shard is locked only once.
+        /// The buffers for the grouped strings are kept per thread for the next batch.
+        void insert_batch(std::span<const STORAGE_TYPE> hashes, std::span<const string_info> strs,
+                          std::span<insert_status> status) FOONATHAN_OVERRIDE
         {
-            assert(head_ && "hash not inserted");
-            auto cur = head_;
-            while (cur->hash < h)
+            assert(hashes.size() == strs.size() && hashes.size() == status.size());
+            if constexpr (N == 1u)
             {
-                cur = cur->next;
-                assert(cur && "hash not inserted");
+                insert_batch(0u, hashes, strs, status);
+                return;
             }
-            assert(cur->hash == h && "hash not inserted");
-            return cur;
+
+            std::size_t begin[N + 1u];
+            auto& b = group_by_shard(hashes, strs, begin);
+            for (std::size_t shard = 0u; shard != N; ++shard)
+                if (auto size = begin[shard + 1u] - begin[shard])
+                    insert_batch(shard, std::span<const STORAGE_TYPE>(b.hashes.data() + begin[shard], size),
+                                 std::span<const string_info>(b.strs.data() + begin[shard], size),
+                                 std::span<insert_status>(b.status.data() + begin[shard], size));
+            for (std::size_t i = 0u; i != b.indices.size(); ++i)
+                status[b.indices[i]] = b.status[i];
         }
 
-        insert_pos_t insert_pos(STORAGE_T hash) FOONATHAN_NOEXCEPT
+        /// \brief Inserts multiple strings with the same prefix at once.
+        /// \detail The strings are grouped by shard like in \ref insert_batch.
+        /// The strings in the shard of the prefix are inserted with a single \c insert_prefix_batch() call,
+        /// for the other shards the prefix is looked up once and the full strings are inserted.
+        void insert_prefix_batch(std::span<const STORAGE_TYPE> hashes, STORAGE_TYPE prefix,
+                                 std::span<const string_info> strs, std::span<insert_status> status) FOONATHAN_OVERRIDE
         {
-            node *cur = head_, *prev = nullptr;
-            while (cur && cur->hash <= hash)
+            assert(hashes.size() == strs.size() && hashes.size() == status.size());
+            auto prefix_shard = shard_index(prefix);
+            if constexpr (N == 1u)
             {
-                if (cur->hash < hash)
+                auto& s = shards_[prefix_shard];
+                auto lock = detail::lock_counted(s.mutex, s.counters);
+                s.db->Database::insert_prefix_batch(hashes, prefix, strs, status);
+                return;
+            }
+
+            std::size_t begin[N + 1u];
+            auto& b = group_by_shard(hashes, strs, begin);
+            if (begin[prefix_shard + 1u] - begin[prefix_shard] != hashes.size())
+            {
+                auto& p = shards_[prefix_shard];
                 {
-                    prev = cur;
-                    cur  = cur->next;
+                    auto lock = detail::lock_counted(p.mutex, p.counters);
+                    b.chars = p.db->Database::lookup_view(prefix);
                 }
-                else if (cur->hash == hash)
-                    return {cur};
+
+                // reserve everything up front, so the pointers into it stay valid
+                auto length_prefix = b.chars.size();
+                auto size          = length_prefix;
+                for (std::size_t i = 0u; i != b.strs.size(); ++i)
+                    size += length_prefix + b.strs[i].length + 1u;
+                b.chars.reserve(size);
+                for (std::size_t shard = 0u; shard != N; ++shard)
+                    for (auto i = begin[shard]; shard != prefix_shard && i != begin[shard + 1u]; ++i)
+                    {
+                        auto offset = b.chars.size();
+                        b.chars.append(b.chars, 0u, length_prefix);
+                        b.chars.append(b.strs[i].string, b.strs[i].length);
+                        b.chars.push_back('\0');
+                        b.strs[i] = string_info(b.chars.data() + offset, length_prefix + b.strs[i].length);
+                    }
             }
-            return {prev ? prev->next : head_, cur};
+
+            for (std::size_t shard = 0u; shard != N; ++shard)
+                if (auto size = begin[shard + 1u] - begin[shard])
+                {
+                    std::span<const STORAGE_TYPE> shard_hashes(b.hashes.data() + begin[shard], size);
+                    std::span<const string_info>  shard_strs(b.strs.data() + begin[shard], size);
+                    std::span<insert_status>      shard_status(b.status.data() + begin[shard], size);
+                    if (shard == prefix_shard)
+                    {
+                        auto& s = shards_[shard];
+                        auto lock = detail::lock_counted(s.mutex, s.counters);
+                        s.db->Database::insert_prefix_batch(shard_hashes, prefix, shard_strs, shard_status);
+                    }
+                    else
+                        insert_batch(shard, shard_hashes, shard_strs, shard_status);
+                }
+            for (std::size_t i = 0u; i != b.indices.size(); ++i)
+                status[b.indices[i]] = b.status[i];
         }
 
-        node* head_;
-    };
-    /// \endcond
+        /// \brief Inserts multiple strings that all belong to the given shard, see \ref shard_index().
+        /// \detail Only this shard is locked, so different shards can be filled in parallel.
+        void insert_batch(std::size_t shard, std::span<const STORAGE_TYPE> hashes, std::span<const string_info> strs,
+                          std::span<insert_status> status)
+        {
+            assert(shard < N);
+            assert(std::all_of(hashes.begin(), hashes.end(),
+                               [&](STORAGE_TYPE hash) { return shard_index(hash) == shard; }));
+            auto& s = shards_[shard];
+            auto lock = detail::lock_counted(s.mutex, s.counters);
+            s.db->Database::insert_batch(hashes, strs, status);
+        }
 
-    template<typename STORAGE_T>
-    map_database<STORAGE_T>::map_database(std::size_t size, double max_load_factor)
-    : buckets_(new node_list[size]), no_items_(0u), no_buckets_(size),
-      max_load_factor_(max_load_factor),
-      next_resize_(static_cast<std::size_t>(std::floor(no_buckets_ * max_load_factor_)))
-    {}
+        const char* lookup(STORAGE_TYPE hash) const FOONATHAN_NOEXCEPT FOONATHAN_OVERRIDE
+        {
+            auto& s = get_shard(hash);
+            auto lock = detail::lock_counted(s.mutex, s.counters);
+            return s.db->Database::lookup(hash);
+        }
+
+        std::string_view lookup_view(STORAGE_TYPE hash) const FOONATHAN_NOEXCEPT FOONATHAN_OVERRIDE
+        {
+            auto& s = get_shard(hash);
+            auto lock = detail::lock_counted(s.mutex, s.counters);
+            return s.db->Database::lookup_view(hash);
+        }
+
+        /// \brief Returns the strings of multiple hashes at once.
+        /// \detail The hashes are grouped by shard in chunks of \ref lookup_chunk_size via counting sort,
+        /// each shard is locked once per chunk and gets its hashes via a single \c lookup_batch() call.
+        /// It doesn't allocate, the chunks are on the stack.
+        void lookup_batch(std::span<const STORAGE_TYPE> hashes, std::span<const char*> strs) const FOONATHAN_NOEXCEPT FOONATHAN_OVERRIDE
+        {
+            assert(hashes.size() == strs.size());
+            if constexpr (N == 1u)
+            {
+                auto lock = detail::lock_counted(shards_[0].mutex, shards_[0].counters);
+                shards_[0].db->Database::lookup_batch(hashes, strs);
+                return;
+            }
+
+            std::size_t  indices[lookup_chunk_size], begin[N + 1u];
+            STORAGE_TYPE chunk_hashes[lookup_chunk_size];
+            const char*  chunk_strs[lookup_chunk_size];
+            for (std::size_t pos = 0u; pos < hashes.size(); pos += lookup_chunk_size)
+            {
+                auto chunk = hashes.subspan(pos, std::min(lookup_chunk_size, hashes.size() - pos));
+                detail::partition_indices(chunk, shard_bits(), indices, begin);
+                for (std::size_t i = 0u; i != chunk.size(); ++i)
+                    chunk_hashes[i] = chunk[indices[i]];
+
+                for (std::size_t shard = 0u; shard != N; ++shard)
+                    if (auto size = begin[shard + 1u] - begin[shard])
+                    {
+                        auto& s = shards_[shard];
+                        auto lock = detail::lock_counted(s.mutex, s.counters);
+                        s.db->Database::lookup_batch(std::span<const STORAGE_TYPE>(chunk_hashes + begin[shard], size),
+                                                     std::span<const char*>(chunk_strs + begin[shard], size));
+                    }
+                for (std::size_t i = 0u; i != chunk.size(); ++i)
+                    strs[pos + indices[i]] = chunk_strs[i];
+            }
+        }
+
+        /// \brief The number of hashes \c lookup_batch() groups by shard at once.
+        static FOONATHAN_CONSTEXPR std::size_t lookup_chunk_size = 256u;
+
+        /// \brief Returns the statistics of all shards combined.
+        database_stats stats() const FOONATHAN_OVERRIDE
+        {
+            database_stats result;
+            for (auto& s : shards_)
+            {
+                {
+                    auto lock = detail::lock_counted(s.mutex, s.counters);
+                    result += s.db->Database::stats();
+                }
+                s.counters.get(result);
+            }
+            return result;
+        }
+
+        /// \brief Returns the number of shards.
+        static FOONATHAN_CONSTEXPR_FNC std::size_t no_shards() FOONATHAN_NOEXCEPT
+        {
+            return N;
+        }
+
+        /// \brief Returns the index of the shard a hash value belongs to.
+        static FOONATHAN_CONSTEXPR_FNC std::size_t shard_index(STORAGE_TYPE hash) FOONATHAN_NOEXCEPT
+        {
+            if constexpr (N == 1u)
+                return 0u;
+            else
+                return std::size_t(hash >> (sizeof(STORAGE_TYPE) * CHAR_BIT - shard_bits()));
+        }
+
+    private:
+        // reused by insert_batch() and insert_prefix_batch() of the same thread
+        struct batch_buffers
+        {
+            std::vector<std::size_t>   indices;
+            std::vector<STORAGE_TYPE>  hashes;
+            std::vector<string_info>   strs;
+            std::vector<insert_status> status;
+            std::string                chars; // the full strings of insert_prefix_batch()
+        };
+
+        // groups the strings by shard into the buffers of this thread, begin receives the start of each shard
+        static batch_buffers& group_by_shard(std::span<const STORAGE_TYPE> hashes, std::span<const string_info> strs,
+                                             std::size_t* begin)
+        {
+            static thread_local batch_buffers buffers;
+            auto& b = buffers;
+            b.indices.resize(hashes.size());
+            detail::partition_indices(hashes, shard_bits(), b.indices.data(), begin);
+
+            b.hashes.clear();
+            b.strs.clear();
+            for (auto i : b.indices)
+            {
+                b.hashes.push_back(hashes[i]);
+                b.strs.push_back(strs[i]);
+            }
+            b.status.resize(hashes.size());
+            return b;
+        }
+
+        struct alignas(64) shard
+        {
+            std::unique_ptr<base_database> db; // exactly base_database, calls are qualified
+            mutable std::mutex             mutex;
+            [[no_unique_address]] mutable detail::database_counters counters;
+        };
+
+        static FOONATHAN_CONSTEXPR_FNC std::size_t shard_bits() FOONATHAN_NOEXCEPT
+        {
+            std::size_t res = 0u;
+            while ((std::size_t(1) << res) < N)
+                ++res;
+            return res;
+        }
+
+        shard& get_shard(STORAGE_TYPE hash) const FOONATHAN_NOEXCEPT
+        {
+            return shards_[shard_index(hash)];
+        }
+
+        mutable shard shards_[N];
+    };
+
+    /// \brief A thread-safe database that never blocks on \c lookup().
+    /// \detail It is a lock-free split-ordered hash table:
+    /// all strings are stored in one singly linked list sorted by the bit-reversed hash value,
+    /// the buckets are only shortcuts into this list and are initialized lazily.<br>
+    /// New nodes are linked in via compare-and-swap, growing the table just doubles the number of buckets.
+    /// Nodes are never moved or removed, so a \c lookup() doesn't need any synchronization besides atomic loads.
+    /// The buckets added by growing are allocated by the insert that grows the table, so a \c lookup() never allocates.
+    template <typename STORAGE_T>
+    class concurrent_map_database : public basic_database<STORAGE_T>
+    {
+    public:
+        /// \brief Creates a new database with given number of buckets and maximum load factor.
+        /// \detail The number of buckets is rounded up to the next power of two.
+        explicit concurrent_map_database(std::size_t size = 1024, double max_load_factor = 1.0);
+        ~concurrent_map_database() FOONATHAN_NOEXCEPT;
+
+        insert_status insert(STORAGE_T hash, const char* str, std::size_t length) FOONATHAN_OVERRIDE;
+        insert_status insert_prefix(STORAGE_T hash, STORAGE_T prefix, const char* str, std::size_t length) FOONATHAN_OVERRIDE;
+        insert_status insert_verify(STORAGE_T hash, const char* str, std::size_t length,
+                                    verify_level level) FOONATHAN_OVERRIDE;
+
+        /// \brief Inserts multiple strings with the same prefix at once.
+        /// \detail The prefix is only looked up once, nothing is locked.
+        void insert_prefix_batch(std::span<const STORAGE_T> hashes, STORAGE_T prefix,
+                                 std::span<const string_info> strs, std::span<insert_status> status) FOONATHAN_OVERRIDE;
+
+        const char* lookup(STORAGE_T hash) const FOONATHAN_NOEXCEPT FOONATHAN_OVERRIDE;
+        std::string_view lookup_view(STORAGE_T hash) const FOONATHAN_NOEXCEPT FOONATHAN_OVERRIDE;
+
+        /// \brief Returns the statistics, it visits all strings.
+        /// \detail The chain length of a bucket is the number of strings until the next initialized bucket.
+        /// It can be called concurrently to inserts, strings inserted meanwhile may or may not be counted.
+        database_stats stats() const FOONATHAN_OVERRIDE;
+
+    private:
+        struct node;
+
+        std::size_t segment_of(std::size_t& i) const FOONATHAN_NOEXCEPT;
+        std::atomic<node*>* allocate_segment(std::size_t segment);
+        std::atomic<node*>* find_bucket(std::size_t i) const FOONATHAN_NOEXCEPT;
+        std::atomic<node*>& bucket(std::size_t i);
+        node* get_bucket(std::size_t i);
+        node* find_node(STORAGE_T hash) const FOONATHAN_NOEXCEPT;
+        insert_status insert_node(STORAGE_T hash, const char* prefix, std::size_t length_prefix,
+                                  const char* str, std::size_t length, bool verify = true);
+        void grow(std::size_t no_items);
+
+        // segment 0 contains the first first_segment_ buckets, segment i the next first_segment_ << (i - 1)
+        static FOONATHAN_CONSTEXPR auto no_segments = sizeof(std::size_t) * CHAR_BIT;
+        mutable std::atomic<std::atomic<node*>*> segments_[no_segments];
+        std::size_t first_segment_, max_buckets_;
+        std::atomic<std::size_t> no_items_, no_buckets_;
+        double max_load_factor_;
+        [[no_unique_address]] mutable detail::database_counters counters_;
+    };
+
+    /// \cond impl
+    namespace detail
+    {
+        // second hash of a string to detect collisions without storing it
+        // FNV-1a with a different basis, so it can be continued for prefixes
+        FOONATHAN_CONSTEXPR inline std::uint64_t fingerprint_basis = 0x84222325CBF29CE4ull;
+
+        inline std::uint64_t fingerprint(const char* str, std::size_t length,
+                                         std::uint64_t hash = fingerprint_basis) FOONATHAN_NOEXCEPT
+        {
+            return FNV1aHashN(str, length, hash, fnv_params<std::uint64_t>::prime);
+        }
+    } // namespace detail
+
+    template <typename STORAGE_T, class Arena, bool StoreStrings, bool SharePrefixes>
+    class map_database<STORAGE_T, Arena, StoreStrings, SharePrefixes>::node_list
+    {
+        typedef detail::ref_table<SharePrefixes> ref_table;
+
+        struct node
+        {
+            node*         next;
+            STORAGE_T     hash;
+            std::uint32_t length : 31; // length of string
+            std::uint32_t shared : 1;  // if true: a reference to the prefix node precedes the suffix
+
+            node(const char* str, std::size_t length, STORAGE_T h, node* next) FOONATHAN_NOEXCEPT
+            : next(next),
+              hash(h),
+              length(checked_length(length)),
+              shared(false)
+            {
+                auto dest = payload();
+                strncpy(dest, str, length);
+                dest[length] = 0;
+            }
+
+            node(const char* prefix, std::size_t length_prefix, const char* str,
+                 std::size_t length_string, STORAGE_T h, node* next) FOONATHAN_NOEXCEPT
+            : next(next),
+              hash(h),
+              length(checked_length(length_prefix + length_string)),
+              shared(false)
+            {
+                auto dest = payload();
+                strncpy(dest, prefix, length_prefix);
+                dest += length_prefix;
+                strncpy(dest, str, length_string);
+                dest[length_string] = 0;
+            }
+
+            // only stores a reference to the prefix node and the suffix
+            node(const node& prefix, std::uint32_t prefix_index, const char* str, std::size_t length_string, STORAGE_T h,
+                 node* next) FOONATHAN_NOEXCEPT
+            : next(next),
+              hash(h),
+              length(checked_length(prefix.length + length_string)),
+              shared(true)
+            {
+                ::new(static_cast<void*>(payload())) shared_ref((prefix_index << 1) | 1u);
+                auto dest = payload() + sizeof(shared_ref);
+                strncpy(dest, str, length_string);
+                dest[length_string] = 0;
+            }
+
+            // stores the fingerprint instead of the string
+            node(std::uint64_t fingerprint, STORAGE_T h, node* next) FOONATHAN_NOEXCEPT
+            : next(next),
+              hash(h),
+              length(0u),
+              shared(false)
+            {
+                std::memcpy(payload(), &fingerprint, sizeof(fingerprint));
+            }
+
+            static FOONATHAN_CONSTEXPR std::size_t max_length = (std::size_t(1u) << 31) - 1u;
+
+            static void check_length(std::size_t length)
+            {
+                if (length > max_length)
+                    throw string_length_error(length, max_length);
+            }
+
+            // memory needed for a node sharing the prefix
+            static std::size_t shared_size(std::size_t length_string) FOONATHAN_NOEXCEPT
+            {
+                return sizeof(node) + sizeof(shared_ref) + length_string + 1;
+            }
+
+            // only valid if not shared
+            const char* get_str() const FOONATHAN_NOEXCEPT
+            {
+                assert(!shared);
+                return payload();
+            }
+
+            std::uint64_t get_fingerprint() const FOONATHAN_NOEXCEPT
+            {
+                std::uint64_t res;
+                std::memcpy(&res, payload(), sizeof(res));
+                return res;
+            }
+
+            // the prefix node of a shared node, nullptr if the string was materialized
+            const node* prefix_node(const ref_table& refs) const FOONATHAN_NOEXCEPT
+            {
+                auto ref = get_ref().load(std::memory_order_acquire);
+                return ref & 1u ? static_cast<const node*>(refs[ref >> 1]) : nullptr;
+            }
+
+            // the full string of a shared node, nullptr if it wasn't materialized yet
+            const char* materialized(const ref_table& refs) const FOONATHAN_NOEXCEPT
+            {
+                auto ref = get_ref().load(std::memory_order_acquire);
+                return ref & 1u ? nullptr : static_cast<const char*>(refs[ref >> 1]);
+            }
+
+            const char* suffix() const FOONATHAN_NOEXCEPT
+            {
+                return payload() + sizeof(shared_ref);
+            }
+
+            // calls f(str, length) for the contiguous parts of the string in order
+            template <typename Func>
+            void for_each_part(const ref_table& refs, Func& f) const
+            {
+                if (!shared)
+                    f(get_str(), std::size_t(length));
+                else if (auto str = materialized(refs))
+                    f(str, std::size_t(length));
+                else
+                {
+                    auto prefix = prefix_node(refs);
+                    prefix->for_each_part(refs, f);
+                    f(suffix(), std::size_t(length - prefix->length));
+                }
+            }
+
+            // compares the characters [offset, offset + length) with str
+            bool equal(const ref_table& refs, std::size_t offset, const char* str, std::size_t length) const FOONATHAN_NOEXCEPT
+            {
+                if (!shared)
+                    return std::memcmp(get_str() + offset, str, length) == 0;
+                else if (auto full = materialized(refs))
+                    return std::memcmp(full + offset, str, length) == 0;
+
+                auto prefix        = prefix_node(refs);
+                auto length_prefix = std::size_t(prefix->length);
+                if (offset < length_prefix)
+                {
+                    auto n = std::min(length, length_prefix - offset);
+                    if (!prefix->equal(refs, offset, str, n))
+                        return false;
+                    offset += n;
+                    str += n;
+                    length -= n;
+                }
+                return std::memcmp(suffix() + (offset - length_prefix), str, length) == 0;
+            }
+
+            // equivalent to std::string(str, length) == string of node
+            bool equal(const ref_table& refs, const char* str, std::size_t length) const FOONATHAN_NOEXCEPT
+            {
+                return this->length == length && equal(refs, 0u, str, length);
+            }
+
+            // equivalent to string of prefix + std::string(str, length) == string of node
+            bool equal(const ref_table& refs, const node& prefix, const char* str, std::size_t length) const FOONATHAN_NOEXCEPT
+            {
+                if (this->length != prefix.length + length)
+                    return false;
+                else if (shared && prefix_node(refs) == &prefix)
+                    return std::memcmp(suffix(), str, length) == 0;
+
+                std::size_t offset = 0u;
+                auto result = true;
+                auto compare = [&](const char* part, std::size_t n)
+                {
+                    result = result && equal(refs, offset, part, n);
+                    offset += n;
+                };
+                prefix.for_each_part(refs, compare);
+                return result && equal(refs, offset, str, length);
+            }
+
+            // copies the string of a shared node into the arena, so it can be returned by lookup
+            const char* materialize(Arena& arena, ref_table& refs) const
+            {
+                auto mem  = static_cast<char*>(arena.allocate(length + 1u, 1u));
+                auto dest = mem;
+                auto copy = [&](const char* part, std::size_t n)
+                {
+                    std::memcpy(dest, part, n);
+                    dest += n;
+                };
+                for_each_part(refs, copy);
+                *dest = 0;
+                get_ref().store(refs.add(arena, mem) << 1, std::memory_order_release);
+                return mem;
+            }
+
+        private:
+            // tagged index into the ref_table: the prefix node with the lowest bit set or the materialized string
+            typedef std::atomic<std::uint32_t> shared_ref;
+
+            static std::uint32_t checked_length(std::size_t length) FOONATHAN_NOEXCEPT
+            {
+                assert(length <= max_length && "string too long, call check_length() first");
+                return static_cast<std::uint32_t>(length);
+            }
+
+            char* payload() const FOONATHAN_NOEXCEPT
+            {
+                const void* mem = this;
+                return const_cast<char*>(static_cast<const char*>(mem) + sizeof(node));
+            }
+
+            shared_ref& get_ref() const FOONATHAN_NOEXCEPT
+            {
+                assert(shared);
+                return *static_cast<shared_ref*>(static_cast<void*>(payload()));
+            }
+        };
+
+        struct insert_pos_t
+        {
+            bool exists; // if true: cur set, else: prev and next set
+
+            node*& prev;
+            node*  next;
+
+            node* cur;
+
+            insert_pos_t(node*& prev, node* next) FOONATHAN_NOEXCEPT 
+                : exists(false),
+                  prev(prev),
+                  next(next),
+                  cur(nullptr)
+            {}
+
+            insert_pos_t(node* cur) FOONATHAN_NOEXCEPT 
+                : exists(true),
+                  prev(this->cur),
+                  next(nullptr),
+                  cur(cur)
+            {}
+        };
+
+    public:
+        // upper bound for the memory needed for a string besides its characters
+        static FOONATHAN_CONSTEXPR std::size_t node_overhead = sizeof(node) + alignof(node);
+
+        node_list() FOONATHAN_NOEXCEPT : head_(nullptr) {}
+
+        // if verify is false, an existing string with the same hash is not compared
+        insert_status insert(Arena& arena, const ref_table& refs, STORAGE_T hash, const char* str, std::size_t length,
+                             bool verify)
+        {
+            if constexpr (!StoreStrings)
+                return insert_fingerprint(arena, hash, verify, [&] { return detail::fingerprint(str, length); });
+
+            auto pos = insert_pos(hash);
+            if (pos.exists)
+                return !verify || pos.cur->equal(refs, str, length) ? insert_status::old_string
+                                                                    : insert_status::collision;
+            node::check_length(length);
+            auto mem = arena.allocate(sizeof(node) + length + 1, alignof(node));
+            auto n   = ::new (mem) node(str, length, hash, pos.next);
+            pos.prev = n;
+            return insert_status::new_string;
+        }
+
+        insert_status insert_prefix(Arena& arena, ref_table& refs, node_list& prefix_bucket, STORAGE_T prefix,
+                                    STORAGE_T hash, const char* str, std::size_t length)
+        {
+            auto prefix_node = prefix_bucket.find_node(prefix);
+            if constexpr (!StoreStrings)
+                return insert_fingerprint(arena, hash, true, [&] {
+                    return detail::fingerprint(str, length, prefix_node->get_fingerprint());
+                });
+
+            auto pos = insert_pos(hash);
+            if (pos.exists)
+                return pos.cur->equal(refs, *prefix_node, str, length) ? insert_status::old_string
+                                                                       : insert_status::collision;
+            node::check_length(prefix_node->length + length);
+            node*         n;
+            std::uint32_t prefix_index;
+            if (SharePrefixes && node::shared_size(length) < sizeof(node) + prefix_node->length + length + 1
+                && refs.share(arena, prefix_node, prefix_index))
+            {
+                auto mem = arena.allocate(node::shared_size(length), alignof(node));
+                n        = ::new (mem) node(*prefix_node, prefix_index, str, length, hash, pos.next);
+            }
+            else if (prefix_node->shared)
+            {
+                // the prefix isn't stored contiguously
+                std::string full;
+                auto append = [&](const char* part, std::size_t n) { full.append(part, n); };
+                prefix_node->for_each_part(refs, append);
+                full.append(str, length);
+                auto mem = arena.allocate(sizeof(node) + full.size() + 1, alignof(node));
+                n        = ::new (mem) node(full.c_str(), full.size(), hash, pos.next);
+            }
+            else
+            {
+                auto mem = arena.allocate(sizeof(node) + prefix_node->length + length + 1, alignof(node));
+                n        = ::new (mem) node(prefix_node->get_str(), prefix_node->length, str, length, hash, pos.next);
+            }
+            pos.prev = n;
+            return insert_status::new_string;
+        }
+
+        // inserts all nodes into new buckets, this list is empty afterwards
+        void rehash(node_list* buckets, std::size_t size) FOONATHAN_NOEXCEPT
+        {
+            auto cur = head_;
+            while (cur)
+            {
+                auto next = cur->next;
+                auto pos  = buckets[cur->hash & (size - 1u)].insert_pos(cur->hash);
+                assert(!pos.exists && "element can't be there already");
+                pos.prev  = cur;
+                cur->next = pos.next;
+                cur       = next;
+            }
+            head_ = nullptr;
+        }
+
+        void prefetch_head() const FOONATHAN_NOEXCEPT
+        {
+            if (head_)
+                detail::prefetch(head_);
+        }
+
+        // returns element with hash, there must be one
+        // a shared string is materialized into the arena while the mutex is locked
+        template <class Mutex>
+        std::string_view lookup(STORAGE_T h, Arena& arena, ref_table& refs, Mutex& mutex) const FOONATHAN_NOEXCEPT
+        {
+            if constexpr (!StoreStrings)
+                return "string_id database does not store strings";
+            auto n = find_node(h);
+            if (!n->shared)
+                return {n->get_str(), n->length};
+            else if (auto str = n->materialized(refs))
+                return {str, n->length};
+            std::lock_guard<Mutex> lock(mutex);
+            if (auto str = n->materialized(refs))
+                return {str, n->length};
+            try
+            {
+                return {n->materialize(arena, refs), n->length};
+            }
+            catch (...)
+            {
+                // lookup() can't throw, the next one tries again
+                return "string_id database out of memory";
+            }
+        }
+
+        // adds the length of the chain and the memory of the strings
+        void add_stats(database_stats& stats, const ref_table& refs) const FOONATHAN_NOEXCEPT
+        {
+            std::size_t length = 0u;
+            for (auto cur = head_; cur; cur = cur->next, ++length)
+                if (!StoreStrings)
+                    stats.string_bytes += sizeof(std::uint64_t);
+                else if (!cur->shared)
+                    stats.string_bytes += cur->length + 1u;
+                else
+                    stats.string_bytes += node::shared_size(std::strlen(cur->suffix())) - sizeof(node)
+                                          + (cur->materialized(refs) ? cur->length + 1u + sizeof(void*) : 0u);
+            ++stats.chain_lengths[std::min(length, database_stats::max_chain_length)];
+        }
+
+    private:
+        // the fingerprint is only computed if needed
+        template <typename Fingerprint>
+        insert_status insert_fingerprint(Arena& arena, STORAGE_T hash, bool verify, Fingerprint get_fingerprint)
+        {
+            auto pos = insert_pos(hash);
+            if (pos.exists)
+                return !verify || get_fingerprint() == pos.cur->get_fingerprint() ? insert_status::old_string
+                                                                                  : insert_status::collision;
+            auto fingerprint = get_fingerprint();
+            auto mem = arena.allocate(sizeof(node) + sizeof(fingerprint), alignof(node));
+            auto n   = ::new (mem) node(fingerprint, hash, pos.next);
+            pos.prev = n;
+            return insert_status::new_string;
+        }
+
+        node* find_node(STORAGE_T h) const FOONATHAN_NOEXCEPT
+        {
+            assert(head_ && "hash not inserted");
+            auto cur = head_;
+            while (cur->hash < h)
+            {
+                cur = cur->next;
+                assert(cur && "hash not inserted");
+            }
+            assert(cur->hash == h && "hash not inserted");
+            return cur;
+        }
+
+        insert_pos_t insert_pos(STORAGE_T hash) FOONATHAN_NOEXCEPT
+        {
+            node *cur = head_, *prev = nullptr;
+            while (cur && cur->hash <= hash)
+            {
+                if (cur->hash < hash)
+                {
+                    prev = cur;
+                    cur  = cur->next;
+                }
+                else if (cur->hash == hash)
+                    return {cur};
+            }
+            return {prev ? prev->next : head_, cur};
+        }
 
-    template <typename STORAGE_T>
-    map_database<STORAGE_T>::~map_database() FOONATHAN_NOEXCEPT {}
+        node* head_;
+    };
+    /// \endcond
 
-    template <typename STORAGE_T>
-    insert_status map_database<STORAGE_T>::insert(STORAGE_T hash, const char* str, std::size_t length)
+    template <typename STORAGE_T, class Arena, bool StoreStrings, bool SharePrefixes>
+    map_database<STORAGE_T, Arena, StoreStrings, SharePrefixes>::map_database(std::size_t size, double max_load_factor, arena_type arena)
+    : arena_(std::move(arena)), buckets_(detail::make_cache_aligned<node_list>(detail::round_up_pow2(size))),
+      no_items_(0u), no_buckets_(detail::round_up_pow2(size)),
+      max_load_factor_(max_load_factor),
+      next_resize_(static_cast<std::size_t>(std::floor(no_buckets_ * max_load_factor_))),
+      no_old_buckets_(0u), migrate_pos_(0u), rehash_step_(0u), migrate_step_(0u)
+    {}
+
+    template <typename STORAGE_T, class Arena, bool StoreStrings, bool SharePrefixes>
+    map_database<STORAGE_T, Arena, StoreStrings, SharePrefixes>::~map_database() FOONATHAN_NOEXCEPT {}
+
+    template <typename STORAGE_T, class Arena, bool StoreStrings, bool SharePrefixes>
+    insert_status map_database<STORAGE_T, Arena, StoreStrings, SharePrefixes>::insert(STORAGE_T hash, const char* str, std::size_t length)
+    {
+        return map_database::insert_verify(hash, str, length, verify_level::full);
+    }
+
+    template <typename STORAGE_T, class Arena, bool StoreStrings, bool SharePrefixes>
+    insert_status map_database<STORAGE_T, Arena, StoreStrings, SharePrefixes>::insert_verify(STORAGE_T hash, const char* str,
+                                                                              std::size_t length, verify_level level)
     {
         if (no_items_ + 1 >= next_resize_)
-            rehash();
-        auto status = buckets_[hash % no_buckets_].insert(hash, str, length);
+            grow(1u);
+        migrate(migrate_step_);
+        auto status = bucket(hash).insert(arena_, refs_, hash, str, length, level == verify_level::full);
         if (status == insert_status::new_string)
             ++no_items_;
+        counters_.insert(status);
         return status;
     }
 
-    template <typename STORAGE_T>
-    insert_status map_database<STORAGE_T>::insert_prefix(STORAGE_T hash, STORAGE_T prefix, const char* str, std::size_t length)
+    template <typename STORAGE_T, class Arena, bool StoreStrings, bool SharePrefixes>
+    insert_status map_database<STORAGE_T, Arena, StoreStrings, SharePrefixes>::insert_prefix(STORAGE_T hash, STORAGE_T prefix, const char* str, std::size_t length)
     {
         if (no_items_ + 1 >= next_resize_)
-            rehash();
-        auto status = buckets_[hash % no_buckets_].insert_prefix(buckets_[prefix % no_buckets_], prefix, hash, str, length);
+            grow(1u);
+        migrate(migrate_step_);
+        auto status = bucket(hash).insert_prefix(arena_, refs_, bucket(prefix), prefix, hash, str, length);
         if (status == insert_status::new_string)
             ++no_items_;
+        counters_.insert(status);
         return status;
     }
 
-    template <typename STORAGE_T>
-    const char* map_database<STORAGE_T>::lookup(STORAGE_T hash) const FOONATHAN_NOEXCEPT
+    template <typename STORAGE_T, class Arena, bool StoreStrings, bool SharePrefixes>
+    void map_database<STORAGE_T, Arena, StoreStrings, SharePrefixes>::insert_batch(std::span<const STORAGE_T> hashes, std::span<const string_info> strs,
+                                                      std::span<insert_status> status)
+    {
+        assert(hashes.size() == strs.size() && hashes.size() == status.size());
+        static FOONATHAN_CONSTEXPR std::size_t prefetch_distance = 8u;
+
+        grow(hashes.size());
+        for (std::size_t i = 0u; i != hashes.size(); ++i)
+        {
+            if (i + prefetch_distance < hashes.size())
+                detail::prefetch(&bucket(hashes[i + prefetch_distance]));
+            migrate(migrate_step_);
+            status[i] = bucket(hashes[i]).insert(arena_, refs_, hashes[i], strs[i].string, strs[i].length, true);
+            if (status[i] == insert_status::new_string)
+                ++no_items_;
+            counters_.insert(status[i]);
+        }
+    }
+
+    template <typename STORAGE_T, class Arena, bool StoreStrings, bool SharePrefixes>
+    void map_database<STORAGE_T, Arena, StoreStrings, SharePrefixes>::insert_prefix_batch(std::span<const STORAGE_T> hashes, STORAGE_T prefix,
+                                                                           std::span<const string_info> strs,
+                                                                           std::span<insert_status> status)
+    {
+        assert(hashes.size() == strs.size() && hashes.size() == status.size());
+        static FOONATHAN_CONSTEXPR std::size_t prefetch_distance = 8u;
+
+        grow(hashes.size());
+        for (std::size_t i = 0u; i != hashes.size(); ++i)
+        {
+            if (i + prefetch_distance < hashes.size())
+                detail::prefetch(&bucket(hashes[i + prefetch_distance]));
+            migrate(migrate_step_);
+            status[i] = bucket(hashes[i]).insert_prefix(arena_, refs_, bucket(prefix), prefix, hashes[i],
+                                                               strs[i].string, strs[i].length);
+            if (status[i] == insert_status::new_string)
+                ++no_items_;
+            counters_.insert(status[i]);
+        }
+    }
+
+    template <typename STORAGE_T, class Arena, bool StoreStrings, bool SharePrefixes>
+    const char* map_database<STORAGE_T, Arena, StoreStrings, SharePrefixes>::lookup(STORAGE_T hash) const FOONATHAN_NOEXCEPT
+    {
+        return map_database::lookup_view(hash).data();
+    }
+
+    template <typename STORAGE_T, class Arena, bool StoreStrings, bool SharePrefixes>
+    std::string_view map_database<STORAGE_T, Arena, StoreStrings, SharePrefixes>::lookup_view(STORAGE_T hash) const FOONATHAN_NOEXCEPT
     {
+        counters_.lookup();
         if (hash == 0) {
             return "<invalid>";
         }
-        return buckets_[hash % no_buckets_].lookup(hash);
+        return bucket(hash).lookup(hash, arena_, refs_, materialize_mutex_);
     }
 
-    template <typename STORAGE_T>
-    void map_database<STORAGE_T>::rehash()
+    template <typename STORAGE_T, class Arena, bool StoreStrings, bool SharePrefixes>
+    void map_database<STORAGE_T, Arena, StoreStrings, SharePrefixes>::lookup_batch(std::span<const STORAGE_T> hashes,
+                                                                        std::span<const char*> strs) const FOONATHAN_NOEXCEPT
+    {
+        assert(hashes.size() == strs.size());
+        static FOONATHAN_CONSTEXPR std::size_t prefetch_distance = 8u;
+
+        // the head of a bucket can only be prefetched once the bucket itself is in the cache
+        for (std::size_t i = 0u; i != hashes.size(); ++i)
+        {
+            if (i + 2 * prefetch_distance < hashes.size())
+                detail::prefetch(&bucket(hashes[i + 2 * prefetch_distance]));
+            if (i + prefetch_distance < hashes.size())
+                bucket(hashes[i + prefetch_distance]).prefetch_head();
+            strs[i] = map_database::lookup_view(hashes[i]).data();
+        }
+    }
+
+    template <typename STORAGE_T, class Arena, bool StoreStrings, bool SharePrefixes>
+    database_stats map_database<STORAGE_T, Arena, StoreStrings, SharePrefixes>::stats() const
+    {
+        database_stats result;
+        result.no_items   = no_items_;
+        result.no_buckets = no_buckets_ + no_old_buckets_;
+        for (std::size_t i = 0u; i != no_buckets_; ++i)
+            buckets_[i].add_stats(result, refs_);
+        for (std::size_t i = 0u; i != no_old_buckets_; ++i)
+            old_buckets_[i].add_stats(result, refs_);
+        counters_.get(result);
+        return result;
+    }
+
+    // returns the bucket the hash is in, during an incremental rehash it may be an old one
+    template <typename STORAGE_T, class Arena, bool StoreStrings, bool SharePrefixes>
+    typename map_database<STORAGE_T, Arena, StoreStrings, SharePrefixes>::node_list& map_database<STORAGE_T, Arena, StoreStrings, SharePrefixes>::bucket(
+        STORAGE_T hash) const FOONATHAN_NOEXCEPT
+    {
+        if (old_buckets_)
+        {
+            auto old_index = hash & (no_old_buckets_ - 1u);
+            if (old_index >= migrate_pos_)
+                return old_buckets_[old_index];
+        }
+        return buckets_[hash & (no_buckets_ - 1u)];
+    }
+
+    // returns the number of buckets needed so that no_new more items can be inserted without resizing again
+    template <typename STORAGE_T, class Arena, bool StoreStrings, bool SharePrefixes>
+    std::size_t map_database<STORAGE_T, Arena, StoreStrings, SharePrefixes>::grown_size(std::size_t no_new) const FOONATHAN_NOEXCEPT
+    {
+        static FOONATHAN_CONSTEXPR auto growth_factor = 2;
+        auto new_size = no_buckets_;
+        while (no_items_ + no_new >= static_cast<std::size_t>(std::floor(new_size * max_load_factor_)))
+            new_size *= growth_factor;
+        return new_size;
+    }
+
+    template <typename STORAGE_T, class Arena, bool StoreStrings, bool SharePrefixes>
+    void map_database<STORAGE_T, Arena, StoreStrings, SharePrefixes>::grow(std::size_t no_new)
+    {
+        auto new_size = grown_size(no_new);
+        if (new_size == no_buckets_)
+            return;
+        else if (rehash_step_)
+            start_rehash(new_size);
+        else
+            rehash(new_size);
+    }
+
+    template <typename STORAGE_T, class Arena, bool StoreStrings, bool SharePrefixes>
+    void map_database<STORAGE_T, Arena, StoreStrings, SharePrefixes>::reserve(std::size_t no_strings, std::size_t no_bytes)
+    {
+        if (no_strings <= no_items_)
+            return;
+        auto no_new   = no_strings - no_items_;
+        auto new_size = grown_size(no_new);
+        if (new_size != no_buckets_)
+            rehash(new_size);
+        if constexpr (requires(Arena& a) { a.reserve(no_bytes); })
+            if (no_bytes || !StoreStrings)
+                arena_.reserve(StoreStrings ? no_bytes + no_new * (node_list::node_overhead + 1)
+                                            : no_new * (node_list::node_overhead + sizeof(std::uint64_t)));
+    }
+
+    template <typename STORAGE_T, class Arena, bool StoreStrings, bool SharePrefixes>
+    void map_database<STORAGE_T, Arena, StoreStrings, SharePrefixes>::shrink_to_fit()
     {
         static FOONATHAN_CONSTEXPR auto growth_factor = 2;
-        auto new_size = growth_factor * no_buckets_;
-        auto buckets = new node_list[new_size]();
+        auto new_size = no_buckets_;
+        while (new_size / growth_factor
+               && no_items_ + 1 < static_cast<std::size_t>(std::floor(new_size / growth_factor * max_load_factor_)))
+            new_size /= growth_factor;
+        if (new_size != no_buckets_)
+            rehash(new_size);
+    }
+
+    template <typename STORAGE_T, class Arena, bool StoreStrings, bool SharePrefixes>
+    void map_database<STORAGE_T, Arena, StoreStrings, SharePrefixes>::rehash(std::size_t new_size)
+    {
+        auto handler = get_rehash_handler();
+        auto timed   = handler || FOONATHAN_STRING_ID_STATS;
+        auto start   = timed ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
+
+        migrate(no_old_buckets_);
+        auto buckets = detail::make_cache_aligned<node_list>(new_size);
         auto end = buckets_.get() + no_buckets_;
         for (auto list = buckets_.get(); list != end; ++list)
-            list->rehash(buckets, new_size);
-        buckets_.reset(buckets);
-        no_buckets_  = new_size;
-        next_resize_ = static_cast<std::size_t>(std::floor(no_buckets_ * max_load_factor_));
+            list->rehash(buckets.get(), new_size);
+        buckets_ = std::move(buckets);
+        auto old_size = std::exchange(no_buckets_, new_size);
+        next_resize_  = static_cast<std::size_t>(std::floor(no_buckets_ * max_load_factor_));
+
+        auto duration = timed ? std::chrono::steady_clock::now() - start : std::chrono::nanoseconds(0);
+        counters_.rehash(duration);
+        if (handler)
+            handler({old_size, new_size, no_items_, duration});
+    }
+
+    template <typename STORAGE_T, class Arena, bool StoreStrings, bool SharePrefixes>
+    void map_database<STORAGE_T, Arena, StoreStrings, SharePrefixes>::start_rehash(std::size_t new_size)
+    {
+        auto handler = get_rehash_handler();
+        auto timed   = handler || FOONATHAN_STRING_ID_STATS;
+        auto start   = timed ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
+
+        // a previous rehash must be finished first
+        migrate(no_old_buckets_);
+        old_buckets_    = std::exchange(buckets_, detail::make_cache_aligned<node_list>(new_size));
+        no_old_buckets_ = std::exchange(no_buckets_, new_size);
+        migrate_pos_    = 0u;
+        next_resize_    = static_cast<std::size_t>(std::floor(no_buckets_ * max_load_factor_));
+        // the migration must be finished by the insert triggering the next rehash
+        auto no_inserts = next_resize_ > no_items_ + 1u ? next_resize_ - no_items_ - 1u : 1u;
+        migrate_step_   = std::max(rehash_step_, (no_old_buckets_ + no_inserts - 1u) / no_inserts);
+
+        auto duration = timed ? std::chrono::steady_clock::now() - start : std::chrono::nanoseconds(0);
+        counters_.rehash(duration);
+        if (handler)
+            handler({no_old_buckets_, new_size, no_items_, duration});
+    }
+
+    // moves the nodes of the next no_buckets old buckets into the new ones
+    template <typename STORAGE_T, class Arena, bool StoreStrings, bool SharePrefixes>
+    void map_database<STORAGE_T, Arena, StoreStrings, SharePrefixes>::migrate(std::size_t no_buckets) FOONATHAN_NOEXCEPT
+    {
+        if (!old_buckets_)
+            return;
+        for (auto end = std::min(migrate_pos_ + no_buckets, no_old_buckets_); migrate_pos_ != end; ++migrate_pos_)
+            old_buckets_[migrate_pos_].rehash(buckets_.get(), no_buckets_);
+        if (migrate_pos_ == no_old_buckets_)
+        {
+            old_buckets_.reset();
+            no_old_buckets_ = migrate_pos_ = 0u;
+        }
+    }
+
+#if FOONATHAN_STRING_ID_ATOMIC_HANDLER
+    inline std::atomic<rehash_handler> rehash_h(nullptr);
+#else
+    inline rehash_handler rehash_h(nullptr);
+#endif
+
+    inline rehash_handler set_rehash_handler(rehash_handler h)
+    {
+#if FOONATHAN_STRING_ID_ATOMIC_HANDLER
+        return rehash_h.exchange(h);
+#else
+        auto val = rehash_h;
+        rehash_h = h;
+        return val;
+#endif
+    }
+
+    inline rehash_handler get_rehash_handler()
+    {
+        return rehash_h;
     }
     
-    /// \brief The default database where the strings are stored.
-    /// \detail Its exact type is one of the previous listed databases.
-    /// You can control its selection via the macros listed in config.hpp.in.
-#if FOONATHAN_STRING_ID_DATABASE && FOONATHAN_STRING_ID_MULTITHREADED
-    typedef thread_safe_database<map_database<uint32_t>> default_database;
+    /// \cond impl
+    namespace detail
+    {
+        inline uint32_t reverse_bits(uint32_t v) FOONATHAN_NOEXCEPT
+        {
+            v = ((v >> 1) & 0x55555555u) | ((v & 0x55555555u) << 1);
+            v = ((v >> 2) & 0x33333333u) | ((v & 0x33333333u) << 2);
+            v = ((v >> 4) & 0x0F0F0F0Fu) | ((v & 0x0F0F0F0Fu) << 4);
+            v = ((v >> 8) & 0x00FF00FFu) | ((v & 0x00FF00FFu) << 8);
+            return (v >> 16) | (v << 16);
+        }
+
+        inline uint64_t reverse_bits(uint64_t v) FOONATHAN_NOEXCEPT
+        {
+            return (uint64_t(reverse_bits(uint32_t(v))) << 32) | reverse_bits(uint32_t(v >> 32));
+        }
+    } // namespace detail
+
+    // ordered by (key, !dummy): a bucket node precedes all nodes with the same bit-reversed prefix
+    template <typename STORAGE_T>
+    struct concurrent_map_database<STORAGE_T>::node
+    {
+        STORAGE_T          key; // bit-reversed hash or bucket index
+        STORAGE_T          hash;
+        std::size_t        length;
+        std::atomic<node*> next;
+        bool               dummy;
+
+        node(STORAGE_T key, STORAGE_T hash, std::size_t length, bool dummy) FOONATHAN_NOEXCEPT
+        : key(key), hash(hash), length(length), next(nullptr), dummy(dummy)
+        {}
+
+        static node* create_dummy(std::size_t bucket)
+        {
+            auto mem = ::operator new(sizeof(node));
+            return ::new (mem) node(detail::reverse_bits(STORAGE_T(bucket)), STORAGE_T(bucket), 0u, true);
+        }
+
+        static node* create(STORAGE_T hash, const char* prefix, std::size_t length_prefix,
+                            const char* str, std::size_t length)
+        {
+            auto mem  = ::operator new(sizeof(node) + length_prefix + length + 1);
+            auto n    = ::new (mem) node(detail::reverse_bits(hash), hash, length_prefix + length, false);
+            auto dest = static_cast<char*>(mem) + sizeof(node);
+            std::strncpy(dest, prefix, length_prefix);
+            std::strncpy(dest + length_prefix, str, length);
+            dest[length_prefix + length] = 0;
+            return n;
+        }
+
+        static void destroy(node* n) FOONATHAN_NOEXCEPT
+        {
+            n->~node();
+            ::operator delete(n);
+        }
+
+        const char* get_str() const FOONATHAN_NOEXCEPT
+        {
+            const void* mem = this;
+            return static_cast<const char*>(mem) + sizeof(node);
+        }
+
+        bool less(STORAGE_T k, bool d) const FOONATHAN_NOEXCEPT
+        {
+            return key < k || (key == k && dummy && !d);
+        }
+
+        // returns the first node not less than (k, d) after start, prev is the node before it
+        static node* find(node*& prev, STORAGE_T k, bool d) FOONATHAN_NOEXCEPT
+        {
+            auto cur = prev->next.load(std::memory_order_acquire);
+            while (cur && cur->less(k, d))
+            {
+                prev = cur;
+                cur  = cur->next.load(std::memory_order_acquire);
+            }
+            return cur;
+        }
+
+        // links n after prev or returns the equal node already there
+        static node* link(node* prev, node* n) FOONATHAN_NOEXCEPT
+        {
+            for (;;)
+            {
+                auto cur = find(prev, n->key, n->dummy);
+                if (cur && cur->key == n->key && cur->dummy == n->dummy)
+                    return cur;
+                n->next.store(cur, std::memory_order_relaxed);
+                // nodes are never removed, so prev stays valid on failure
+                if (prev->next.compare_exchange_weak(cur, n, std::memory_order_release,
+                                                     std::memory_order_relaxed))
+                    return n;
+            }
+        }
+    };
+    /// \endcond
+
+    template <typename STORAGE_T>
+    concurrent_map_database<STORAGE_T>::concurrent_map_database(std::size_t size, double max_load_factor)
+    : first_segment_(detail::round_up_pow2(size)),
+      max_buckets_(sizeof(STORAGE_T) < sizeof(std::size_t)
+                       ? std::size_t(1) << (sizeof(STORAGE_T) * CHAR_BIT)
+                       : std::size_t(1) << (sizeof(std::size_t) * CHAR_BIT - 1)),
+      no_items_(0u), no_buckets_(first_segment_), max_load_factor_(max_load_factor)
+    {
+        for (auto& segment : segments_)
+            segment.store(nullptr, std::memory_order_relaxed);
+        segments_[0].store(new std::atomic<node*>[first_segment_](), std::memory_order_relaxed);
+        find_bucket(0)->store(node::create_dummy(0), std::memory_order_release);
+    }
+
+    template <typename STORAGE_T>
+    concurrent_map_database<STORAGE_T>::~concurrent_map_database() FOONATHAN_NOEXCEPT
+    {
+        auto cur = find_bucket(0)->load(std::memory_order_relaxed);
+        while (cur)
+        {
+            auto next = cur->next.load(std::memory_order_relaxed);
+            node::destroy(cur);
+            cur = next;
+        }
+        for (auto& segment : segments_)
+            delete[] segment.load(std::memory_order_relaxed);
+    }
+
+    template <typename STORAGE_T>
+    insert_status concurrent_map_database<STORAGE_T>::insert(STORAGE_T hash, const char* str, std::size_t length)
+    {
+        auto status = insert_node(hash, "", 0u, str, length);
+        counters_.insert(status);
+        return status;
+    }
+
+    template <typename STORAGE_T>
+    insert_status concurrent_map_database<STORAGE_T>::insert_verify(STORAGE_T hash, const char* str,
+                                                                   std::size_t length, verify_level level)
+    {
+        auto status = insert_node(hash, "", 0u, str, length, level == verify_level::full);
+        counters_.insert(status);
+        return status;
+    }
+
+    template <typename STORAGE_T>
+    insert_status concurrent_map_database<STORAGE_T>::insert_prefix(STORAGE_T hash, STORAGE_T prefix,
+                                                                   const char* str, std::size_t length)
+    {
+        auto prefix_node = find_node(prefix);
+        auto status      = insert_node(hash, prefix_node->get_str(), prefix_node->length, str, length);
+        counters_.insert(status);
+        return status;
+    }
+
+    template <typename STORAGE_T>
+    void concurrent_map_database<STORAGE_T>::insert_prefix_batch(std::span<const STORAGE_T> hashes,
+                                                                 STORAGE_T prefix,
+                                                                 std::span<const string_info> strs,
+                                                                 std::span<insert_status> status)
+    {
+        assert(hashes.size() == strs.size() && hashes.size() == status.size());
+        auto prefix_node = find_node(prefix);
+        for (std::size_t i = 0u; i != hashes.size(); ++i)
+        {
+            status[i] = insert_node(hashes[i], prefix_node->get_str(), prefix_node->length,
+                                    strs[i].string, strs[i].length);
+            counters_.insert(status[i]);
+        }
+    }
+
+    template <typename STORAGE_T>
+    const char* concurrent_map_database<STORAGE_T>::lookup(STORAGE_T hash) const FOONATHAN_NOEXCEPT
+    {
+        return concurrent_map_database::lookup_view(hash).data();
+    }
+
+    template <typename STORAGE_T>
+    std::string_view concurrent_map_database<STORAGE_T>::lookup_view(STORAGE_T hash) const FOONATHAN_NOEXCEPT
+    {
+        counters_.lookup();
+        if (hash == 0)
+            return "<invalid>";
+        auto n = find_node(hash);
+        return {n->get_str(), n->length};
+    }
+
+    template <typename STORAGE_T>
+    database_stats concurrent_map_database<STORAGE_T>::stats() const
+    {
+        database_stats result;
+        result.no_items   = no_items_.load(std::memory_order_relaxed);
+        result.no_buckets = no_buckets_.load(std::memory_order_relaxed);
+
+        std::size_t length = 0u;
+        for (auto cur = find_bucket(0)->load(std::memory_order_acquire)->next.load(std::memory_order_acquire); cur;
+             cur      = cur->next.load(std::memory_order_acquire))
+            if (cur->dummy)
+            {
+                ++result.chain_lengths[std::min(length, database_stats::max_chain_length)];
+                length = 0u;
+            }
+            else
+            {
+                ++length;
+                result.string_bytes += cur->length + 1u;
+            }
+        ++result.chain_lengths[std::min(length, database_stats::max_chain_length)];
+
+        counters_.get(result);
+        return result;
+    }
+
+    // returns the segment of bucket i, i becomes the index inside it
+    template <typename STORAGE_T>
+    std::size_t concurrent_map_database<STORAGE_T>::segment_of(std::size_t& i) const FOONATHAN_NOEXCEPT
+    {
+        std::size_t segment = 0u;
+        if (i >= first_segment_)
+        {
+            auto base = first_segment_;
+            for (segment = 1u; i >= 2 * base; ++segment)
+                base *= 2;
+            i -= base;
+        }
+        return segment;
+    }
+
+    template <typename STORAGE_T>
+    std::atomic<typename concurrent_map_database<STORAGE_T>::node*>*
+        concurrent_map_database<STORAGE_T>::allocate_segment(std::size_t segment)
+    {
+        auto buckets = segments_[segment].load(std::memory_order_acquire);
+        if (!buckets)
+        {
+            auto size = segment == 0u ? first_segment_ : first_segment_ << (segment - 1);
+            auto mem  = new std::atomic<node*>[size]();
+            if (segments_[segment].compare_exchange_strong(buckets, mem, std::memory_order_acq_rel))
+                buckets = mem;
+            else
+                delete[] mem;
+        }
+        return buckets;
+    }
+
+    // returns nullptr if the segment of the bucket isn't allocated, lookups never allocate
+    template <typename STORAGE_T>
+    std::atomic<typename concurrent_map_database<STORAGE_T>::node*>*
+        concurrent_map_database<STORAGE_T>::find_bucket(std::size_t i) const FOONATHAN_NOEXCEPT
+    {
+        auto segment = segment_of(i);
+        auto buckets = segments_[segment].load(std::memory_order_acquire);
+        return buckets ? buckets + i : nullptr;
+    }
+
+    template <typename STORAGE_T>
+    std::atomic<typename concurrent_map_database<STORAGE_T>::node*>&
+        concurrent_map_database<STORAGE_T>::bucket(std::size_t i)
+    {
+        auto segment = segment_of(i);
+        return allocate_segment(segment)[i];
+    }
+
+    template <typename STORAGE_T>
+    typename concurrent_map_database<STORAGE_T>::node* concurrent_map_database<STORAGE_T>::get_bucket(std::size_t i)
+    {
+        auto& b = bucket(i);
+        auto dummy = b.load(std::memory_order_acquire);
+        if (dummy)
+            return dummy;
+
+        // parent bucket: i without its most significant bit
+        auto parent = i;
+        for (auto bit = std::size_t(1); bit <= i; bit <<= 1)
+            if (i & bit)
+                parent = i & ~bit;
+        auto n = node::create_dummy(i);
+        dummy  = node::link(get_bucket(parent), n);
+        if (dummy != n)
+            node::destroy(n);
+        b.store(dummy, std::memory_order_release);
+        return dummy;
+    }
+
+    // returns the node with given hash, there must be one
+    template <typename STORAGE_T>
+    typename concurrent_map_database<STORAGE_T>::node* concurrent_map_database<STORAGE_T>::find_node(
+        STORAGE_T hash) const FOONATHAN_NOEXCEPT
+    {
+        auto i = hash & (no_buckets_.load(std::memory_order_acquire) - 1);
+        auto b = find_bucket(i);
+        auto prev = b ? b->load(std::memory_order_acquire) : nullptr;
+        while (!prev)
+        {
+            // not initialized yet, start from the first initialized parent bucket
+            auto bit = std::size_t(1);
+            while (bit <= i / 2)
+                bit <<= 1;
+            i &= ~bit;
+            b    = find_bucket(i);
+            prev = b ? b->load(std::memory_order_acquire) : nullptr;
+        }
+        auto key = detail::reverse_bits(hash);
+        auto cur = node::find(prev, key, false);
+        assert(cur && cur->key == key && !cur->dummy && "hash not inserted");
+        return cur;
+    }
+
+    template <typename STORAGE_T>
+    insert_status concurrent_map_database<STORAGE_T>::insert_node(STORAGE_T hash, const char* prefix,
+                                                                 std::size_t length_prefix, const char* str,
+                                                                 std::size_t length, bool verify)
+    {
+        auto start = get_bucket(hash & (no_buckets_.load(std::memory_order_acquire) - 1));
+
+        // look for an existing node first to avoid the allocation
+        auto key = detail::reverse_bits(hash);
+        auto cur = node::find(start, key, false);
+        if (!cur || cur->key != key || cur->dummy)
+        {
+            auto n = node::create(hash, prefix, length_prefix, str, length);
+            cur    = node::link(start, n);
+            if (cur == n)
+            {
+                grow(no_items_.fetch_add(1u, std::memory_order_relaxed) + 1u);
+                return insert_status::new_string;
+            }
+            node::destroy(n);
+        }
+        return !verify || strequal(prefix, str, length, cur->get_str()) ? insert_status::old_string
+                                                                        : insert_status::collision;
+    }
+
+    template <typename STORAGE_T>
+    void concurrent_map_database<STORAGE_T>::grow(std::size_t no_items)
+    {
+        auto size = no_buckets_.load(std::memory_order_relaxed);
+        if (no_items > size * max_load_factor_ && size < max_buckets_)
+        {
+            // the new buckets are exactly the next segment, it is allocated before they are published
+            auto first = size;
+            allocate_segment(segment_of(first));
+            // failure means somebody else has grown it already
+            if (no_buckets_.compare_exchange_strong(size, 2 * size, std::memory_order_release,
+                                                    std::memory_order_relaxed))
+                counters_.rehash(std::chrono::nanoseconds(0));
+        }
+    }
+
+    /// \brief An adapter for other databases caching the results of \c lookup() per thread.
+    /// \detail Each thread has a direct-mapped cache of \c CacheSize entries for each database type,
+    /// a hit neither calls the base database nor locks.
+    /// This is possible because the pointers returned by \c lookup() stay valid as long as the database exists.
+    /// Inserts are not cached.<br>
+    /// \c CacheSize must be a power of two.
+    template <class Database, std::size_t CacheSize = 256u>
+    class cached_database : public Database
+    {
+        static_assert(CacheSize != 0u && (CacheSize & (CacheSize - 1u)) == 0u, "cache size must be a power of two");
+
+    public:
+        /// \brief The base database.
+        typedef Database base_database;
+
+        /// \brief The type of the hash values.
+        typedef typename base_database::STORAGE_TYPE STORAGE_TYPE;
+
+        /// \brief The number of entries in the cache of each thread.
+        static FOONATHAN_CONSTEXPR std::size_t cache_size = CacheSize;
+
+        template <typename ... Args>
+        explicit cached_database(Args&&... args)
+        : base_database(std::forward<Args>(args)...), id_(next_id()) {}
+
+        const char* lookup(STORAGE_TYPE hash) const FOONATHAN_NOEXCEPT FOONATHAN_OVERRIDE
+        {
+            return cached_database::lookup_view(hash).data();
+        }
+
+        std::string_view lookup_view(STORAGE_TYPE hash) const FOONATHAN_NOEXCEPT FOONATHAN_OVERRIDE
+        {
+            auto& entry = cache()[static_cast<std::size_t>(hash) & (CacheSize - 1u)];
+            if (entry.owner == id_ && entry.hash == hash)
+                return entry.str;
+            auto str = Database::lookup_view(hash);
+            entry    = {id_, hash, str};
+            return str;
+        }
+
+    private:
+        // the cache is shared by all databases of this type,
+        // so entries are tagged with an id that is unique for each database ever created
+        struct entry
+        {
+            std::uint64_t owner;
+            STORAGE_TYPE     hash;
+            std::string_view str;
+        };
+
+        static entry* cache() FOONATHAN_NOEXCEPT
+        {
+            static thread_local entry entries[CacheSize] = {};
+            return entries;
+        }
+
+        static std::uint64_t next_id() FOONATHAN_NOEXCEPT
+        {
+            static std::atomic<std::uint64_t> counter(0u);
+            return ++counter;
+        }
+
+        std::uint64_t id_;
+    };
+
+    /// \cond impl
+    namespace detail
+    {
+        template <typename STORAGE_T>
+        using default_map_database = map_database<STORAGE_T, memory_arena, FOONATHAN_STRING_ID_STORE_STRINGS,
+                                                  FOONATHAN_STRING_ID_SHARE_PREFIXES>;
+
+#if FOONATHAN_STRING_ID_DATABASE && FOONATHAN_STRING_ID_MULTITHREADED && FOONATHAN_STRING_ID_LOCK_FREE
+        template <typename STORAGE_T>
+        using default_database = concurrent_map_database<STORAGE_T>;
+#elif FOONATHAN_STRING_ID_DATABASE && FOONATHAN_STRING_ID_MULTITHREADED && FOONATHAN_STRING_ID_SHARDS > 1
+        template <typename STORAGE_T>
+        using default_database = sharded_database<default_map_database<STORAGE_T>, FOONATHAN_STRING_ID_SHARDS>;
+#elif FOONATHAN_STRING_ID_DATABASE && FOONATHAN_STRING_ID_MULTITHREADED && FOONATHAN_STRING_ID_SHARED_MUTEX
+        template <typename STORAGE_T>
+        using default_database = thread_safe_database<default_map_database<STORAGE_T>, std::shared_mutex>;
+#elif FOONATHAN_STRING_ID_DATABASE && FOONATHAN_STRING_ID_MULTITHREADED
+        template <typename STORAGE_T>
+        using default_database = thread_safe_database<default_map_database<STORAGE_T>>;
 #elif FOONATHAN_STRING_ID_DATABASE
-    typedef map_database<uint32_t> default_database;
+        template <typename STORAGE_T>
+        using default_database = default_map_database<STORAGE_T>;
+#else
+        template <typename STORAGE_T>
+        using default_database = dummy_database<STORAGE_T>;
+#endif
+    } // namespace detail
+    /// \endcond
+
+    /// \brief The default database for hash values of type \c STORAGE_T.
+    /// \detail Its exact type is one of the previous listed databases,
+    /// wrapped in a \ref cached_database if \ref FOONATHAN_STRING_ID_LOOKUP_CACHE is not \c 0.
+    /// You can control its selection via the macros listed in config.hpp.in.
+#if FOONATHAN_STRING_ID_DATABASE && FOONATHAN_STRING_ID_LOOKUP_CACHE
+    template <typename STORAGE_T>
+    using basic_default_database = cached_database<detail::default_database<STORAGE_T>, FOONATHAN_STRING_ID_LOOKUP_CACHE>;
 #else
-    typedef dummy_database<uint32_t> default_database;
+    template <typename STORAGE_T>
+    using basic_default_database = detail::default_database<STORAGE_T>;
 #endif
+
+    /// \brief The default database for 32 bit hash values.
+    typedef basic_default_database<uint32_t> default_database;
+
+    /// \brief The default database for 64 bit hash values.
+    /// \detail With 32 bit hashes collisions become likely at a few million strings,
+    /// with 64 bit hashes only at a few billion.
+    typedef basic_default_database<uint64_t> default_database64;
 }} // namespace foonathan::string_id
 
 #endif // FOONATHAN_STRING_ID_DATABASE_HPP_INCLUDED
@@ -6,8 +6,9 @@
 #define FOONATHAN_STRING_ID_ERROR_HPP_INCLUDED
 
 #include <atomic>
+#include <cstddef>
+#include <cstdio>
 #include <exception>
-#include <string>
 
 #include "config.hpp"
 #include "hash.hpp"
@@ -20,10 +21,23 @@ namespace foonathan { namespace string_id
     protected:
         error() = default;
     };
+
+    /// \cond impl
+    namespace detail
+    {
+        // copies the null-terminated str into a buffer of given size, truncating it if necessary
+        inline void copy_truncated(char* dest, std::size_t size, const char* str) FOONATHAN_NOEXCEPT
+        {
+            std::snprintf(dest, size, "%s", str);
+        }
+    } // namespace detail
+    /// \endcond
     
     /// \brief The type of the collision handler.
     /// \detail It will be called when a string hashing results in a collision giving it the two strings collided.
     /// The default handler throws an exception of type \ref collision_error.
+    /// Throwing allocates the exception object, use \c string_id::try_make() to get the status
+    /// instead of calling the handler where that isn't possible.
     template<typename STORAGE_T>
     using collision_handler = void(*)(STORAGE_T hash, const char *a, const char *b);
     //typedef void(*collision_handler)(hash_type hash, const char *a, const char *b);
@@ -38,16 +52,26 @@ namespace foonathan { namespace string_id
     collision_handler<STORAGE_T> get_collision_handler();
     
     /// \brief The exception class thrown by the default \ref collision_handler.
+    /// \detail The strings are stored in fixed-size buffers, so creating it doesn't allocate memory,
+    /// but throwing it allocates the whole object including the buffers.
     template<typename STORAGE_T>
     class collision_error : public error
     {
     public:
+        /// \brief The maximum length of the strings stored, longer ones are truncated.
+        static FOONATHAN_CONSTEXPR std::size_t max_string_length = 127u;
+
         //=== constructor/destructor ===//
         /// \brief Creates a new exception, same parameter as \ref collision_handler.
-        collision_error(STORAGE_T hash, const char* a, const char* b)
-        : a_(a), b_(b),
-          what_(R"(foonathan::string_id::collision_error: strings ")" + a_ + R"(" and ")" + b_ +
-                R"(") are both producing the value )" + std::to_string(hash)), hash_(hash) {}
+        collision_error(STORAGE_T hash, const char* a, const char* b) FOONATHAN_NOEXCEPT
+        : hash_(hash)
+        {
+            detail::copy_truncated(a_, sizeof(a_), a);
+            detail::copy_truncated(b_, sizeof(b_), b);
+            std::snprintf(what_, sizeof(what_),
+                          R"(foonathan::string_id::collision_error: strings "%s" and "%s" are both producing the value %llu)",
+                          a_, b_, static_cast<unsigned long long>(hash));
+        }
         
         ~collision_error() FOONATHAN_NOEXCEPT FOONATHAN_OVERRIDE {}
         
@@ -56,14 +80,15 @@ namespace foonathan { namespace string_id
         
         /// @{
         /// \brief Returns one of the two strings that colllided.
+        /// \detail They are truncated to \ref max_string_length characters.
         const char* first_string() const FOONATHAN_NOEXCEPT
         {
-            return a_.c_str();
+            return a_;
         }
         
         const char* second_string() const FOONATHAN_NOEXCEPT
         {
-            return b_.c_str();
+            return b_;
         }
         /// @}
         
@@ -74,7 +99,8 @@ namespace foonathan { namespace string_id
         }
         
     private:
-        std::string a_, b_, what_;
+        char a_[max_string_length + 1], b_[max_string_length + 1];
+        char what_[2 * max_string_length + 128];
         STORAGE_T hash_;
     };
     
@@ -83,6 +109,8 @@ namespace foonathan { namespace string_id
     /// The generator will try again until the handler returns \c false in which case it just returns the old \c string_id.
     /// It passes the number of tries, the name of the generator and the hash and string of the generated \c string_id.<br>
     /// The default handler allows 8 tries and then throws an exception of type \ref generation_error.
+    /// Throwing allocates the exception object, the generators also provide \c try_generate()
+    /// which doesn't call the handler at all.
     template<typename STORAGE_T>
     using generation_error_handler = bool (*)(std::size_t no, const char* generator_name, STORAGE_T hash, const char* str);
     
@@ -96,14 +124,17 @@ namespace foonathan { namespace string_id
     inline generation_error_handler<STORAGE_T> get_generation_error_handler();
     
     /// \brief The exception class thrown by the default \ref generation_error_handler.
+    /// \detail The name is stored in a fixed-size buffer, so creating it doesn't allocate memory,
+    /// but throwing it allocates the whole object including the buffer.
     class generation_error : public error
     {
     public:
+        /// \brief The maximum length of the generator name stored, longer ones are truncated.
+        static FOONATHAN_CONSTEXPR std::size_t max_name_length = 127u;
+
         //=== constructor/destructor ===//
         /// \brief Creates it by giving it the name of the generator.
-        generation_error(const char *generator_name)
-        : name_(generator_name), what_("foonathan::string_id::generation_error: Generator \"" + name_ +
-                                       "\" was unable to generate new string id.") {}
+        generation_error(const char *generator_name) FOONATHAN_NOEXCEPT;
         
         ~generation_error() FOONATHAN_NOEXCEPT FOONATHAN_OVERRIDE {}
         
@@ -113,11 +144,12 @@ namespace foonathan { namespace string_id
         /// \brief Returns the name of the generator.
         const char* generator_name() const FOONATHAN_NOEXCEPT
         {
-            return name_.c_str();
+            return name_;
         }
         
     private:
-        std::string name_, what_;
+        char name_[max_name_length + 1];
+        char what_[max_name_length + 128];
     };
 
     template <typename STORAGE_T>
@@ -138,7 +170,7 @@ namespace foonathan { namespace string_id
     inline collision_handler<STORAGE_T> set_collision_handler(collision_handler<STORAGE_T> h)
     {
 #if FOONATHAN_STRING_ID_ATOMIC_HANDLER
-        return collision_h.exchange(h);
+        return collision_h<STORAGE_T>.exchange(h);
 #else
         auto val    = collision_h;
         collision_h = h;
@@ -155,14 +187,7 @@ namespace foonathan { namespace string_id
     template<typename STORAGE_T>
     const char* collision_error<STORAGE_T>::what() const FOONATHAN_NOEXCEPT
     {
-        try
-        {
-            return what_.c_str();
-        }
-        catch (...)
-        {
-            return "foonathan::string_id::collision_error: two different strings are producing the same value";
-        }
+        return what_;
     }
 
     FOONATHAN_CONSTEXPR inline auto no_tries_generation = 8u;
@@ -188,7 +213,7 @@ namespace foonathan { namespace string_id
     inline generation_error_handler<STORAGE_T> set_generation_error_handler(generation_error_handler<STORAGE_T> h)
     {
 #if FOONATHAN_STRING_ID_ATOMIC_HANDLER
-        return generation_error_h.exchange(h);
+        return generation_error_h<STORAGE_T>.exchange(h);
 #else
         auto val = generation_error_h;
         generation_error_h = h;
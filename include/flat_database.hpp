@@ -0,0 +1,479 @@
+// Copyright (C) 2014-2015 Jonathan Müller <jonathanmueller.dev@gmail.com>
+// This file is subject to the license terms in the LICENSE file
+// found in the top-level directory of this distribution.
+
+#ifndef FOONATHAN_STRING_ID_FLAT_DATABASE_HPP_INCLUDED
+#define FOONATHAN_STRING_ID_FLAT_DATABASE_HPP_INCLUDED
+
+#include <bit>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <span>
+#include <string_view>
+
+#include "arena.hpp"
+#include "basic_database.hpp"
+#include "config.hpp"
+
+#if FOONATHAN_STRING_ID_AVX2
+    #include <immintrin.h>
+#elif FOONATHAN_STRING_ID_SSE2
+    #include <emmintrin.h>
+#elif FOONATHAN_STRING_ID_NEON
+    #include <arm_neon.h>
+#endif
+
+namespace foonathan { namespace string_id
+{
+    /// \cond impl
+    namespace detail
+    {
+        // the slots with the set bits of a group, each slot has 1 << shift bits
+        template <typename T, unsigned Shift>
+        class group_mask
+        {
+        public:
+            explicit group_mask(T bits) FOONATHAN_NOEXCEPT : bits_(bits) {}
+
+            explicit operator bool() const FOONATHAN_NOEXCEPT
+            {
+                return bits_ != 0u;
+            }
+
+            std::size_t lowest() const FOONATHAN_NOEXCEPT
+            {
+                return static_cast<std::size_t>(std::countr_zero(bits_)) >> Shift;
+            }
+
+            void clear_lowest() FOONATHAN_NOEXCEPT
+            {
+                bits_ &= bits_ - 1;
+            }
+
+        private:
+            T bits_;
+        };
+
+        // control bytes of a group of slots:
+        // empty slots have the value 0x80, full slots the lowest 7 bits of the hash
+        FOONATHAN_CONSTEXPR std::uint8_t ctrl_empty = 0x80;
+
+    #if FOONATHAN_STRING_ID_AVX2
+        struct probe_group
+        {
+            static FOONATHAN_CONSTEXPR std::size_t width = 32u;
+            typedef group_mask<std::uint32_t, 0> mask;
+
+            static mask match(const std::uint8_t* ctrl, std::uint8_t tag) FOONATHAN_NOEXCEPT
+            {
+                auto group = _mm256_load_si256(reinterpret_cast<const __m256i*>(ctrl));
+                auto eq    = _mm256_cmpeq_epi8(group, _mm256_set1_epi8(static_cast<char>(tag)));
+                return mask(static_cast<std::uint32_t>(_mm256_movemask_epi8(eq)));
+            }
+
+            static mask match_empty(const std::uint8_t* ctrl) FOONATHAN_NOEXCEPT
+            {
+                auto group = _mm256_load_si256(reinterpret_cast<const __m256i*>(ctrl));
+                return mask(static_cast<std::uint32_t>(_mm256_movemask_epi8(group)));
+            }
+        };
+    #elif FOONATHAN_STRING_ID_SSE2
+        struct probe_group
+        {
+            static FOONATHAN_CONSTEXPR std::size_t width = 16u;
+            typedef group_mask<std::uint32_t, 0> mask;
+
+            static mask match(const std::uint8_t* ctrl, std::uint8_t tag) FOONATHAN_NOEXCEPT
+            {
+                auto group = _mm_load_si128(reinterpret_cast<const __m128i*>(ctrl));
+                auto eq    = _mm_cmpeq_epi8(group, _mm_set1_epi8(static_cast<char>(tag)));
+                return mask(static_cast<std::uint32_t>(_mm_movemask_epi8(eq)));
+            }
+
+            static mask match_empty(const std::uint8_t* ctrl) FOONATHAN_NOEXCEPT
+            {
+                auto group = _mm_load_si128(reinterpret_cast<const __m128i*>(ctrl));
+                return mask(static_cast<std::uint32_t>(_mm_movemask_epi8(group)));
+            }
+        };
+    #elif FOONATHAN_STRING_ID_NEON
+        struct probe_group
+        {
+            static FOONATHAN_CONSTEXPR std::size_t width = 16u;
+            // 4 bits per slot, to_mask() requires all bits of a matching byte to be set
+            typedef group_mask<std::uint64_t, 2> mask;
+
+            static mask to_mask(uint8x16_t bytes) FOONATHAN_NOEXCEPT
+            {
+                auto nibbles = vshrn_n_u16(vreinterpretq_u16_u8(bytes), 4);
+                return mask(vget_lane_u64(vreinterpret_u64_u8(nibbles), 0) & 0x8888888888888888ull);
+            }
+
+            static mask match(const std::uint8_t* ctrl, std::uint8_t tag) FOONATHAN_NOEXCEPT
+            {
+                return to_mask(vceqq_u8(vld1q_u8(ctrl), vdupq_n_u8(tag)));
+            }
+
+            static mask match_empty(const std::uint8_t* ctrl) FOONATHAN_NOEXCEPT
+            {
+                return to_mask(vcltq_s8(vreinterpretq_s8_u8(vld1q_u8(ctrl)), vdupq_n_s8(0)));
+            }
+        };
+    #else
+        // scalar fallback: 8 slots at once inside a 64bit integer,
+        // match() may report false positives which are rejected by comparing the hash
+        struct probe_group
+        {
+            static FOONATHAN_CONSTEXPR std::size_t width = 8u;
+            typedef group_mask<std::uint64_t, 3> mask;
+
+            static FOONATHAN_CONSTEXPR std::uint64_t lsbs = 0x0101010101010101ull;
+            static FOONATHAN_CONSTEXPR std::uint64_t msbs = 0x8080808080808080ull;
+
+            // little endian order, so the lowest byte is the first slot
+            static std::uint64_t load(const std::uint8_t* ctrl) FOONATHAN_NOEXCEPT
+            {
+                std::uint64_t res = 0u;
+                for (auto i = 0u; i != width; ++i)
+                    res |= std::uint64_t(ctrl[i]) << (8 * i);
+                return res;
+            }
+
+            static mask match(const std::uint8_t* ctrl, std::uint8_t tag) FOONATHAN_NOEXCEPT
+            {
+                auto x = load(ctrl) ^ (lsbs * tag);
+                return mask((x - lsbs) & ~x & msbs);
+            }
+
+            static mask match_empty(const std::uint8_t* ctrl) FOONATHAN_NOEXCEPT
+            {
+                return mask(load(ctrl) & msbs);
+            }
+        };
+    #endif
+
+        struct alignas(probe_group::width) ctrl_group
+        {
+            std::uint8_t bytes[probe_group::width];
+        };
+    } // namespace detail
+    /// \endcond
+
+    /// \brief A database that uses an open addressing hash table.
+    /// \detail The hash values are stored in one contiguous array,
+    /// a parallel array stores pointers to the strings which are appended to the blocks of an arena of type \c Arena.
+    /// Like in \ref map_database the strings are never freed individually.<br>
+    /// The slots are organized in groups, each slot has a control byte storing 7 bits of its hash value.
+    /// A probe compares the control bytes of a whole group at once, using SSE2, AVX2 or NEON if enabled
+    /// in config.hpp.in, so a lookup usually touches one control group, one hash and one string pointer.
+    template <typename STORAGE_T, class Arena = memory_arena>
+    class flat_database : public basic_database<STORAGE_T>
+    {
+    public:
+        /// \brief The type of the arena the strings are allocated from.
+        typedef Arena arena_type;
+
+        /// \brief Creates a new database with given number of slots and maximum load factor.
+        /// \detail The number of slots is rounded up to a power of two multiple of the group size,
+        /// the maximum load factor must be less than \c 1.
+        explicit flat_database(std::size_t size = 1024, double max_load_factor = 0.875,
+                               arena_type arena = arena_type());
+        ~flat_database() FOONATHAN_NOEXCEPT;
+
+        insert_status insert(STORAGE_T hash, const char* str, std::size_t length) FOONATHAN_OVERRIDE;
+        insert_status insert_prefix(STORAGE_T hash, STORAGE_T prefix, const char* str, std::size_t length) FOONATHAN_OVERRIDE;
+        insert_status insert_verify(STORAGE_T hash, const char* str, std::size_t length,
+                                    verify_level level) FOONATHAN_OVERRIDE;
+
+        /// \brief Inserts multiple strings at once.
+        /// \detail It resizes the table at most once and prefetches the control groups.
+        void insert_batch(std::span<const STORAGE_T> hashes, std::span<const string_info> strs,
+                          std::span<insert_status> status) FOONATHAN_OVERRIDE;
+
+        /// \brief Inserts multiple strings with the same prefix at once.
+        /// \detail Like \ref insert_batch, the prefix is only looked up once.
+        void insert_prefix_batch(std::span<const STORAGE_T> hashes, STORAGE_T prefix,
+                                 std::span<const string_info> strs, std::span<insert_status> status) FOONATHAN_OVERRIDE;
+
+        const char* lookup(STORAGE_T hash) const FOONATHAN_NOEXCEPT FOONATHAN_OVERRIDE;
+
+        /// \brief Returns the string together with its length, which is stored in front of it.
+        std::string_view lookup_view(STORAGE_T hash) const FOONATHAN_NOEXCEPT FOONATHAN_OVERRIDE;
+
+        /// \brief Returns the statistics, it visits all strings.
+        /// \detail The number of buckets is the number of slots, there are no chains.
+        database_stats stats() const FOONATHAN_OVERRIDE;
+
+    private:
+        typedef detail::probe_group probe_group;
+
+        struct position
+        {
+            std::size_t slot; // the slot with the hash or the empty slot where it belongs
+            bool        found;
+        };
+
+        position    find(STORAGE_T hash) const FOONATHAN_NOEXCEPT;
+        std::size_t string_length(const char* str) const FOONATHAN_NOEXCEPT;
+        insert_status insert_impl(STORAGE_T hash, const char* prefix, std::size_t length_prefix,
+                                  const char* str, std::size_t length, bool verify = true);
+        void allocate(std::size_t no_groups);
+        void grow(std::size_t no_new);
+        void rehash(std::size_t no_groups);
+
+        static std::uint8_t tag(STORAGE_T hash) FOONATHAN_NOEXCEPT
+        {
+            return static_cast<std::uint8_t>(hash & 0x7F);
+        }
+
+        std::uint8_t* ctrl() const FOONATHAN_NOEXCEPT
+        {
+            return reinterpret_cast<std::uint8_t*>(ctrl_.get());
+        }
+
+        arena_type                             arena_;
+        std::unique_ptr<detail::ctrl_group[]>  ctrl_;
+        std::unique_ptr<STORAGE_T[]>           hashes_;
+        std::unique_ptr<const char*[]>         strings_;
+        std::size_t no_items_, group_mask_;
+        double      max_load_factor_;
+        std::size_t next_resize_;
+        [[no_unique_address]] mutable detail::database_counters counters_;
+    };
+
+    template <typename STORAGE_T, class Arena>
+    flat_database<STORAGE_T, Arena>::flat_database(std::size_t size, double max_load_factor, arena_type arena)
+    : arena_(std::move(arena)), no_items_(0u), max_load_factor_(max_load_factor)
+    {
+        assert(max_load_factor_ > 0.0 && max_load_factor_ < 1.0 && "invalid load factor");
+        std::size_t no_groups = 1u;
+        while (no_groups * probe_group::width < size)
+            no_groups <<= 1;
+        allocate(no_groups);
+    }
+
+    template <typename STORAGE_T, class Arena>
+    flat_database<STORAGE_T, Arena>::~flat_database() FOONATHAN_NOEXCEPT {}
+
+    template <typename STORAGE_T, class Arena>
+    insert_status flat_database<STORAGE_T, Arena>::insert(STORAGE_T hash, const char* str, std::size_t length)
+    {
+        auto status = insert_impl(hash, "", 0u, str, length);
+        counters_.insert(status);
+        return status;
+    }
+
+    template <typename STORAGE_T, class Arena>
+    insert_status flat_database<STORAGE_T, Arena>::insert_verify(STORAGE_T hash, const char* str,
+                                                                std::size_t length, verify_level level)
+    {
+        auto status = insert_impl(hash, "", 0u, str, length, level == verify_level::full);
+        counters_.insert(status);
+        return status;
+    }
+
+    template <typename STORAGE_T, class Arena>
+    insert_status flat_database<STORAGE_T, Arena>::insert_prefix(STORAGE_T hash, STORAGE_T prefix,
+                                                                const char* str, std::size_t length)
+    {
+        auto pos = find(prefix);
+        assert(pos.found && "prefix not inserted");
+        auto prefix_str = strings_[pos.slot];
+        auto status     = insert_impl(hash, prefix_str, string_length(prefix_str), str, length);
+        counters_.insert(status);
+        return status;
+    }
+
+    template <typename STORAGE_T, class Arena>
+    void flat_database<STORAGE_T, Arena>::insert_batch(std::span<const STORAGE_T> hashes,
+                                                       std::span<const string_info> strs,
+                                                       std::span<insert_status> status)
+    {
+        assert(hashes.size() == strs.size() && hashes.size() == status.size());
+        static FOONATHAN_CONSTEXPR std::size_t prefetch_distance = 8u;
+
+        grow(hashes.size());
+        for (std::size_t i = 0u; i != hashes.size(); ++i)
+        {
+            if (i + prefetch_distance < hashes.size())
+            {
+                auto group = static_cast<std::size_t>(hashes[i + prefetch_distance] >> 7) & group_mask_;
+                detail::prefetch(ctrl() + group * probe_group::width);
+            }
+            status[i] = insert_impl(hashes[i], "", 0u, strs[i].string, strs[i].length);
+            counters_.insert(status[i]);
+        }
+    }
+
+    template <typename STORAGE_T, class Arena>
+    void flat_database<STORAGE_T, Arena>::insert_prefix_batch(std::span<const STORAGE_T> hashes, STORAGE_T prefix,
+                                                              std::span<const string_info> strs,
+                                                              std::span<insert_status> status)
+    {
+        assert(hashes.size() == strs.size() && hashes.size() == status.size());
+        static FOONATHAN_CONSTEXPR std::size_t prefetch_distance = 8u;
+
+        grow(hashes.size());
+        // the strings are in the arena, so the prefix stays valid while inserting
+        auto pos = find(prefix);
+        assert(pos.found && "prefix not inserted");
+        auto prefix_str    = strings_[pos.slot];
+        auto prefix_length = string_length(prefix_str);
+        for (std::size_t i = 0u; i != hashes.size(); ++i)
+        {
+            if (i + prefetch_distance < hashes.size())
+            {
+                auto group = static_cast<std::size_t>(hashes[i + prefetch_distance] >> 7) & group_mask_;
+                detail::prefetch(ctrl() + group * probe_group::width);
+            }
+            status[i] = insert_impl(hashes[i], prefix_str, prefix_length, strs[i].string, strs[i].length);
+            counters_.insert(status[i]);
+        }
+    }
+
+    template <typename STORAGE_T, class Arena>
+    const char* flat_database<STORAGE_T, Arena>::lookup(STORAGE_T hash) const FOONATHAN_NOEXCEPT
+    {
+        return flat_database::lookup_view(hash).data();
+    }
+
+    template <typename STORAGE_T, class Arena>
+    std::string_view flat_database<STORAGE_T, Arena>::lookup_view(STORAGE_T hash) const FOONATHAN_NOEXCEPT
+    {
+        counters_.lookup();
+        auto pos = find(hash);
+        if (!pos.found)
+        {
+            assert(hash == 0u && "hash not inserted");
+            return "<invalid>";
+        }
+        auto str = strings_[pos.slot];
+        return {str, string_length(str)};
+    }
+
+    template <typename STORAGE_T, class Arena>
+    database_stats flat_database<STORAGE_T, Arena>::stats() const
+    {
+        database_stats result;
+        result.no_items   = no_items_;
+        result.no_buckets = (group_mask_ + 1) * probe_group::width;
+        for (std::size_t i = 0u; i != result.no_buckets; ++i)
+            if (ctrl()[i] != detail::ctrl_empty)
+                result.string_bytes += string_length(strings_[i]) + 1u;
+        counters_.get(result);
+        return result;
+    }
+
+    // probes the groups in triangular order which visits every group for power of two sizes
+    template <typename STORAGE_T, class Arena>
+    typename flat_database<STORAGE_T, Arena>::position flat_database<STORAGE_T, Arena>::find(
+        STORAGE_T hash) const FOONATHAN_NOEXCEPT
+    {
+        auto group = static_cast<std::size_t>(hash >> 7) & group_mask_;
+        for (std::size_t step = 1u;; ++step)
+        {
+            auto base = group * probe_group::width;
+            for (auto match = probe_group::match(ctrl() + base, tag(hash)); match; match.clear_lowest())
+            {
+                auto slot = base + match.lowest();
+                if (hashes_[slot] == hash)
+                    return {slot, true};
+            }
+            if (auto empty = probe_group::match_empty(ctrl() + base))
+                return {base + empty.lowest(), false};
+            group = (group + step) & group_mask_;
+        }
+    }
+
+    // the length is stored in front of the string
+    template <typename STORAGE_T, class Arena>
+    std::size_t flat_database<STORAGE_T, Arena>::string_length(const char* str) const FOONATHAN_NOEXCEPT
+    {
+        std::size_t length;
+        std::memcpy(&length, str - sizeof(std::size_t), sizeof(std::size_t));
+        return length;
+    }
+
+    template <typename STORAGE_T, class Arena>
+    insert_status flat_database<STORAGE_T, Arena>::insert_impl(STORAGE_T hash, const char* prefix,
+                                                              std::size_t length_prefix, const char* str,
+                                                              std::size_t length, bool verify)
+    {
+        if (no_items_ + 1 >= next_resize_)
+            grow(1u);
+
+        auto pos = find(hash);
+        if (pos.found)
+            return !verify || strequal(prefix, str, length, strings_[pos.slot]) ? insert_status::old_string
+                                                                                : insert_status::collision;
+
+        auto total = length_prefix + length;
+        auto mem   = static_cast<char*>(arena_.allocate(sizeof(std::size_t) + total + 1, alignof(char)));
+        std::memcpy(mem, &total, sizeof(std::size_t));
+        mem += sizeof(std::size_t);
+        std::memcpy(mem, prefix, length_prefix);
+        std::strncpy(mem + length_prefix, str, length);
+        mem[total] = 0;
+
+        ctrl()[pos.slot]   = tag(hash);
+        hashes_[pos.slot]  = hash;
+        strings_[pos.slot] = mem;
+        ++no_items_;
+        return insert_status::new_string;
+    }
+
+    template <typename STORAGE_T, class Arena>
+    void flat_database<STORAGE_T, Arena>::allocate(std::size_t no_groups)
+    {
+        auto size = no_groups * probe_group::width;
+        ctrl_.reset(new detail::ctrl_group[no_groups]);
+        std::memset(ctrl(), detail::ctrl_empty, size);
+        hashes_.reset(new STORAGE_T[size]);
+        strings_.reset(new const char*[size]);
+        group_mask_  = no_groups - 1;
+        next_resize_ = static_cast<std::size_t>(size * max_load_factor_);
+    }
+
+    // resizes the table so that no_new more items can be inserted without resizing again
+    template <typename STORAGE_T, class Arena>
+    void flat_database<STORAGE_T, Arena>::grow(std::size_t no_new)
+    {
+        static FOONATHAN_CONSTEXPR auto growth_factor = 2;
+        auto no_groups = group_mask_ + 1;
+        while (no_items_ + no_new >= static_cast<std::size_t>(no_groups * probe_group::width * max_load_factor_))
+            no_groups *= growth_factor;
+        if (no_groups != group_mask_ + 1)
+            rehash(no_groups);
+    }
+
+    template <typename STORAGE_T, class Arena>
+    void flat_database<STORAGE_T, Arena>::rehash(std::size_t no_groups)
+    {
+    #if FOONATHAN_STRING_ID_STATS
+        auto start = std::chrono::steady_clock::now();
+    #endif
+        auto old_size    = (group_mask_ + 1) * probe_group::width;
+        auto old_groups  = std::move(ctrl_);
+        auto old_ctrl    = reinterpret_cast<const std::uint8_t*>(old_groups.get());
+        auto old_hashes  = std::move(hashes_);
+        auto old_strings = std::move(strings_);
+
+        allocate(no_groups);
+        for (std::size_t i = 0u; i != old_size; ++i)
+            if (old_ctrl[i] != detail::ctrl_empty)
+            {
+                auto slot      = find(old_hashes[i]).slot;
+                ctrl()[slot]   = old_ctrl[i];
+                hashes_[slot]  = old_hashes[i];
+                strings_[slot] = old_strings[i];
+            }
+    #if FOONATHAN_STRING_ID_STATS
+        counters_.rehash(std::chrono::steady_clock::now() - start);
+    #endif
+    }
+}} // namespace foonathan::string_id
+
+#endif // FOONATHAN_STRING_ID_FLAT_DATABASE_HPP_INCLUDED
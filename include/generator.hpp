@@ -5,8 +5,13 @@
 #ifndef FOONATHAN_STRING_ID_GENERATOR_HPP_INCLUDED
 #define FOONATHAN_STRING_ID_GENERATOR_HPP_INCLUDED
 
+#include <algorithm>
 #include <atomic>
+#include <cstdint>
+#include <limits>
+#include <mutex>
 #include <random>
+#include <vector>
 
 #include "config.hpp"
 #include "string_id.hpp"
@@ -15,20 +20,72 @@ namespace foonathan { namespace string_id
 {
     namespace detail
     {
-        template<typename STRID_T>
-        bool handle_generation_error(std::size_t counter, const char* name, const STRID_T& result)
+        // continues generation after the first try returned result with status
+        // the handler is only loaded once the first try failed
+        template <typename STRID_T, typename Generator>
+        STRID_T retry_generate(const char* name, Generator generator, const STRID_T& prefix,
+                               STRID_T result, insert_status status)
         {
-            return get_generation_error_handler<typename STRID_T::STORAGE_TYPE>()(counter, name, result.hash_code(), result.string());
+            if (status == insert_status::new_string)
+                return result;
+            auto handler = get_generation_error_handler<typename STRID_T::STORAGE_TYPE>();
+            for (std::size_t counter = 1; status != insert_status::new_string
+                                          && handler(counter, name, result.hash_code(), result.string()); ++counter)
+                result = STRID_T(prefix, generator(), status);
+            return result;
         }
-        
+
+        // generates up to max_tries times without calling the handler
+        template <typename STRID_T, typename Generator>
+        bool try_generate_n_times(Generator generator, const STRID_T& prefix, STRID_T& result, std::size_t max_tries)
+        {
+            for (std::size_t i = 0u; i != max_tries; ++i)
+                if (STRID_T::try_make(prefix, generator(), result) == insert_status::new_string)
+                    return true;
+            return false;
+        }
+
         template <typename STRID_T, typename Generator>
         STRID_T try_generate(const char* name, Generator generator, const STRID_T& prefix)
         {
             insert_status status;
             auto result = STRID_T(prefix, generator(), status);
-            for (std::size_t counter = 1; status != insert_status::new_string && handle_generation_error(counter, name, result); ++counter)
-                result = STRID_T(prefix, generator(), status);
-            return result;
+            return retry_generate(name, generator, prefix, result, status);
+        }
+
+        // number of ids generated at once by generate_n()
+        FOONATHAN_CONSTEXPR inline std::size_t generation_batch_size = 4096u;
+
+        // generate_n() for generators appending Length characters written by generate(char*)
+        template <typename STRID_T, typename OutputIt, typename Generator>
+        OutputIt generate_random_n(const char* name, const STRID_T& prefix, std::size_t length,
+                                   OutputIt out, std::size_t n, Generator generate)
+        {
+            std::vector<char>          buffer(std::min(n, generation_batch_size) * length + length);
+            std::vector<string_info>   strs;
+            std::vector<STRID_T>       ids;
+            std::vector<insert_status> status;
+            while (n != 0u)
+            {
+                auto batch = std::min(n, generation_batch_size);
+                strs.clear();
+                for (std::size_t i = 0u; i != batch; ++i)
+                    strs.push_back(generate(buffer.data() + i * length));
+                ids.resize(batch);
+                status.resize(batch);
+                STRID_T::make_batch(prefix, strs, ids, status);
+
+                // the retries use the space after the batch
+                auto retry = buffer.data() + batch * length;
+                for (std::size_t i = 0u; i != batch; ++i)
+                {
+                    if (status[i] != insert_status::new_string)
+                        ids[i] = retry_generate(name, [&]() { return generate(retry); }, prefix, ids[i], status[i]);
+                    *out++ = ids[i];
+                }
+                n -= batch;
+            }
+            return out;
         }
     }
     
@@ -55,6 +112,21 @@ namespace foonathan { namespace string_id
         /// \brief Generates a new \ref string_id.
         /// \detail If it was already generated previously, the \ref generator_error_handler will be called in a loop as described there.
         STRID_T operator()();
+
+        /// \brief Generates a new \ref string_id without calling the \ref generation_error_handler.
+        /// \detail It tries up to \c max_tries times and never throws on failure,
+        /// so it can be used where the handler must not be called, e.g. in code that must not throw or allocate on failure.
+        /// \return \c true if a new id was generated and assigned to \c result.
+        bool try_generate(STRID_T& result, std::size_t max_tries = no_tries_generation);
+
+        /// \brief Generates \c n new \ref string_id objects and writes them to \c out.
+        /// \detail Same as calling \c operator() \c n times,
+        /// but the numbers are reserved with a single atomic operation per batch
+        /// and the ids are inserted via \c string_id::make_batch().
+        /// Multiple threads can call it at the same time, each one gets a disjoint range of numbers.
+        /// \return The output iterator after the last id written.
+        template <typename OutputIt>
+        OutputIt generate_n(OutputIt out, std::size_t n);
         
         /// \brief Discards a number of states by advancing the counter.
         void discard(unsigned long long n) FOONATHAN_NOEXCEPT;
@@ -122,6 +194,42 @@ namespace foonathan { namespace string_id
                         return string_info(random, Length);
                     }, prefix_);
         }
+
+        /// \brief Generates a new \ref string_id without calling the \ref generation_error_handler.
+        /// \detail It tries up to \c max_tries times and never throws on failure,
+        /// so it can be used where the handler must not be called, e.g. in code that must not throw or allocate on failure.
+        /// \return \c true if a new id was generated and assigned to \c result.
+        bool try_generate(STRID_T& result, std::size_t max_tries = no_tries_generation)
+        {
+            std::uniform_int_distribution<std::size_t>
+                dist(0, table_.no_characters - 1);
+            char random[Length];
+            return detail::try_generate_n_times(
+                    [&]()
+                    {
+                        for (std::size_t i = 0u; i != Length; ++i)
+                            random[i] = table_.characters[dist(state_)];
+                        return string_info(random, Length);
+                    }, prefix_, result, max_tries);
+        }
+
+        /// \brief Generates \c n new \ref string_id objects and writes them to \c out.
+        /// \detail Same as calling \c operator() \c n times,
+        /// but the ids are inserted via \c string_id::make_batch().
+        /// \return The output iterator after the last id written.
+        template <typename OutputIt>
+        OutputIt generate_n(OutputIt out, std::size_t n)
+        {
+            std::uniform_int_distribution<std::size_t>
+                dist(0, table_.no_characters - 1);
+            return detail::generate_random_n("foonathan::string_id::random_generator", prefix_, Length, out, n,
+                    [&](char* random)
+                    {
+                        for (std::size_t i = 0u; i != Length; ++i)
+                            random[i] = table_.characters[dist(state_)];
+                        return string_info(random, Length);
+                    });
+        }
         
         /// \brief Discards a certain number of states, this forwards to the random number generator.
         void discard(unsigned long long n)
@@ -135,6 +243,173 @@ namespace foonathan { namespace string_id
         character_table table_;
     };
 
+    /// \brief A small and fast random number generator, xoshiro256** by David Blackman and Sebastiano Vigna.
+    /// \detail It fulfills the requirements of \c UniformRandomBitGenerator and has a state of 32 bytes.
+    /// \c jump() advances it by 2^128 steps, this gives non-overlapping streams for multiple threads.
+    class xoshiro256ss
+    {
+    public:
+        typedef std::uint64_t result_type;
+
+        static FOONATHAN_CONSTEXPR_FNC result_type min() FOONATHAN_NOEXCEPT
+        {
+            return 0u;
+        }
+
+        static FOONATHAN_CONSTEXPR_FNC result_type max() FOONATHAN_NOEXCEPT
+        {
+            return std::numeric_limits<result_type>::max();
+        }
+
+        /// \brief Creates it by expanding the seed via splitmix64.
+        explicit xoshiro256ss(std::uint64_t seed = 0u) FOONATHAN_NOEXCEPT;
+
+        result_type operator()() FOONATHAN_NOEXCEPT
+        {
+            auto result = rotl(state_[1] * 5u, 7) * 9u;
+            auto t      = state_[1] << 17;
+            state_[2] ^= state_[0];
+            state_[3] ^= state_[1];
+            state_[1] ^= state_[2];
+            state_[0] ^= state_[3];
+            state_[2] ^= t;
+            state_[3]  = rotl(state_[3], 45);
+            return result;
+        }
+
+        void discard(unsigned long long n) FOONATHAN_NOEXCEPT
+        {
+            while (n--)
+                (*this)();
+        }
+
+        /// \brief Advances the state by 2^128 steps.
+        void jump() FOONATHAN_NOEXCEPT;
+
+    private:
+        static FOONATHAN_CONSTEXPR_FNC std::uint64_t rotl(std::uint64_t x, int k) FOONATHAN_NOEXCEPT
+        {
+            return (x << k) | (x >> (64 - k));
+        }
+
+        std::uint64_t state_[4];
+    };
+
+    /// \brief A generator that generates string ids by appending random characters to a prefix,
+    /// each thread using its own random number generator.
+    /// \detail It can be used by multiple threads at the same time without locking.
+    /// The first time a thread uses the generator it gets a copy of the current state,
+    /// which is then advanced via \c jump(), so the streams of all threads don't overlap.
+    /// Each thread keeps the engines of the last few generators it used.<br>
+    /// \c Engine must provide \c jump() and return 64 random bits per call, like \ref xoshiro256ss.
+    /// Each call gives two characters, they are mapped via multiplication instead of modulo.
+    template <typename STRID_T, std::size_t Length, class Engine = xoshiro256ss>
+    class per_thread_random_generator
+    {
+        static_assert(Engine::min() == 0u && Engine::max() == std::numeric_limits<std::uint64_t>::max(),
+                      "engine must return 64 random bits");
+
+    public:
+        /// \brief The state of the generator that the engines of the threads are created from.
+        typedef Engine state;
+
+        /// \brief The number of characters appended.
+        static FOONATHAN_CONSTEXPR_FNC std::size_t length() FOONATHAN_NOEXCEPT
+        {
+            return Length;
+        }
+
+        /// \brief Creates a new generator with given prefix, initial state and character table.
+        /// \detail By default is uses the table \ref character_table::alnum().
+        explicit per_thread_random_generator(const STRID_T& prefix,
+                                             state s = state(),
+                                             character_table table = character_table::alnum())
+        : prefix_(prefix), next_(std::move(s)), table_(table), id_(next_id()) {}
+
+        /// \brief Generates a new \ref string_id.
+        /// \detail If it was already generated previously, the \ref generator_error_handler will be called in a loop as described there.
+        STRID_T operator()()
+        {
+            auto& e = engine();
+            char random[Length];
+            return detail::try_generate("foonathan::string_id::per_thread_random_generator",
+                    [&]() { return generate(e, random); }, prefix_);
+        }
+
+        /// \brief Generates a new \ref string_id without calling the \ref generation_error_handler.
+        /// \detail It tries up to \c max_tries times and never throws on failure,
+        /// so it can be used where the handler must not be called, e.g. in code that must not throw or allocate on failure.
+        /// \return \c true if a new id was generated and assigned to \c result.
+        bool try_generate(STRID_T& result, std::size_t max_tries = no_tries_generation)
+        {
+            auto& e = engine();
+            char random[Length];
+            return detail::try_generate_n_times([&]() { return generate(e, random); }, prefix_, result, max_tries);
+        }
+
+        /// \brief Generates \c n new \ref string_id objects and writes them to \c out.
+        /// \detail Same as calling \c operator() \c n times,
+        /// but the ids are inserted via \c string_id::make_batch().
+        /// \return The output iterator after the last id written.
+        template <typename OutputIt>
+        OutputIt generate_n(OutputIt out, std::size_t n)
+        {
+            auto& e = engine();
+            return detail::generate_random_n("foonathan::string_id::per_thread_random_generator", prefix_, Length,
+                                             out, n, [&](char* random) { return generate(e, random); });
+        }
+
+    private:
+        string_info generate(state& e, char* random) const FOONATHAN_NOEXCEPT
+        {
+            auto no = std::uint64_t(table_.no_characters);
+            for (std::size_t i = 0u; i < Length; i += 2u)
+            {
+                auto r = std::uint64_t(e());
+                random[i] = table_.characters[((r & 0xFFFFFFFFu) * no) >> 32];
+                if (i + 1u != Length)
+                    random[i + 1u] = table_.characters[((r >> 32) * no) >> 32];
+            }
+            return string_info(random, Length);
+        }
+
+        // the engines are shared by all generators of this type,
+        // so they are tagged with an id that is unique for each generator ever created
+        struct entry
+        {
+            std::uint64_t owner = 0u;
+            state         engine;
+        };
+
+        static FOONATHAN_CONSTEXPR std::size_t no_entries = 8u;
+
+        state& engine()
+        {
+            static thread_local entry entries[no_entries];
+            auto& e = entries[id_ & (no_entries - 1u)];
+            if (e.owner != id_)
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                e.engine = next_;
+                next_.jump();
+                e.owner = id_;
+            }
+            return e.engine;
+        }
+
+        static std::uint64_t next_id() FOONATHAN_NOEXCEPT
+        {
+            static std::atomic<std::uint64_t> counter(0u);
+            return ++counter;
+        }
+
+        STRID_T prefix_;
+        std::mutex mutex_;
+        state next_;
+        character_table table_;
+        std::uint64_t id_;
+    };
+
     template <typename STRID_T>
     string_info to_string(typename counter_generator<STRID_T>::state s, char* begin, char* end,
                                std::size_t length)
@@ -169,6 +444,55 @@ namespace foonathan { namespace string_id
             [&]() { return to_string<STRID_T>(counter_++, string, string + max_size, length_); }, prefix_);
     }
 
+    template<typename STRID_T>
+    bool counter_generator<STRID_T>::try_generate(STRID_T& result, std::size_t max_tries)
+    {
+        static FOONATHAN_CONSTEXPR auto max_size = 4 * sizeof(state);
+        char string[max_size];
+        return detail::try_generate_n_times(
+            [&]() { return to_string<STRID_T>(counter_++, string, string + max_size, length_); },
+            prefix_, result, max_tries);
+    }
+
+    template<typename STRID_T>
+    template <typename OutputIt>
+    OutputIt counter_generator<STRID_T>::generate_n(OutputIt out, std::size_t n)
+    {
+        static FOONATHAN_CONSTEXPR auto max_size = 4 * sizeof(state);
+        static FOONATHAN_CONSTEXPR auto name = "foonathan::string_id::counter_generator";
+
+        std::vector<char>          buffer(std::min(n, detail::generation_batch_size) * max_size);
+        std::vector<string_info>   strs;
+        std::vector<STRID_T>       ids;
+        std::vector<insert_status> status;
+        while (n != 0u)
+        {
+            auto batch = std::min(n, detail::generation_batch_size);
+            auto first = counter_.fetch_add(batch);
+            strs.clear();
+            for (std::size_t i = 0u; i != batch; ++i)
+            {
+                auto begin = buffer.data() + i * max_size;
+                strs.push_back(to_string<STRID_T>(first + i, begin, begin + max_size, length_));
+            }
+            ids.resize(batch);
+            status.resize(batch);
+            STRID_T::make_batch(prefix_, strs, ids, status);
+
+            char string[max_size];
+            for (std::size_t i = 0u; i != batch; ++i)
+            {
+                if (status[i] != insert_status::new_string)
+                    ids[i] = detail::retry_generate(
+                        name, [&]() { return to_string<STRID_T>(counter_++, string, string + max_size, length_); },
+                        prefix_, ids[i], status[i]);
+                *out++ = ids[i];
+            }
+            n -= batch;
+        }
+        return out;
+    }
+
     template<typename STRID_T>
     void counter_generator<STRID_T>::discard(unsigned long long n) FOONATHAN_NOEXCEPT
     {
@@ -5,7 +5,11 @@
 #ifndef FOONATHAN_STRING_ID_HASH_HPP_INCLUDED
 #define FOONATHAN_STRING_ID_HASH_HPP_INCLUDED
 
+#include <bit>
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
+#include <type_traits>
 
 #include "config.hpp"
 
@@ -18,6 +22,23 @@ namespace foonathan { namespace string_id
         FOONATHAN_CONSTEXPR uint64_t fnv_basis = 14695981039346656037ull;
         FOONATHAN_CONSTEXPR uint64_t fnv_prime = 1099511628211ull;
 
+        template <typename T>
+        struct fnv_params;
+
+        template <>
+        struct fnv_params<uint32_t>
+        {
+            static FOONATHAN_CONSTEXPR uint32_t basis = FNV_32_BASIS;
+            static FOONATHAN_CONSTEXPR uint32_t prime = FNV_32_PRIME;
+        };
+
+        template <>
+        struct fnv_params<uint64_t>
+        {
+            static FOONATHAN_CONSTEXPR uint64_t basis = fnv_basis;
+            static FOONATHAN_CONSTEXPR uint64_t prime = fnv_prime;
+        };
+
         // https://ru.wikipedia.org/wiki/FNV
         template<typename T>
         FOONATHAN_CONSTEXPR_FNC T FNV1aHash(const char* buf, T hval, T prime)
@@ -25,24 +46,312 @@ namespace foonathan { namespace string_id
             while (*buf)
             {
                 hval ^= (T)*buf++;
-                hval *= FNV_32_PRIME;
+                hval *= prime;
+            }
+
+            return hval;
+        }
+
+        // same as above for a string of given length
+        template <typename T>
+        FOONATHAN_CONSTEXPR_FNC T FNV1aHash(const char* buf, std::size_t length, T hval, T prime)
+        {
+            while (length--)
+            {
+                hval ^= (T)*buf++;
+                hval *= prime;
             }
 
             return hval;
         }
-        
+
+        // runtime version of FNV1aHash() for a string of given length, the result is the same
+        // FNV-1a can't be vectorized since each byte depends on the previous result,
+        // but knowing the length avoids checking for the null terminator after each byte
+        template <typename T>
+        inline T FNV1aHashN(const char* buf, std::size_t length, T hval, T prime) FOONATHAN_NOEXCEPT
+        {
+            auto step = [&](char c) {
+                hval ^= (T)c;
+                hval *= prime;
+            };
+
+            for (; length >= 8u; length -= 8u, buf += 8)
+            {
+                step(buf[0]);
+                step(buf[1]);
+                step(buf[2]);
+                step(buf[3]);
+                step(buf[4]);
+                step(buf[5]);
+                step(buf[6]);
+                step(buf[7]);
+            }
+            while (length--)
+                step(*buf++);
+
+            return hval;
+        }
+
+        // little endian reads, byte-wise during constant evaluation
+        FOONATHAN_CONSTEXPR_FNC uint64_t read_le(const char* p, std::size_t n) FOONATHAN_NOEXCEPT
+        {
+            if (!std::is_constant_evaluated() && std::endian::native == std::endian::little)
+            {
+                uint64_t res = 0u;
+                std::memcpy(&res, p, n);
+                return res;
+            }
+
+            uint64_t res = 0u;
+            for (std::size_t i = 0u; i != n; ++i)
+                res |= uint64_t(static_cast<unsigned char>(p[i])) << (8 * i);
+            return res;
+        }
+
+        FOONATHAN_CONSTEXPR_FNC uint64_t read64(const char* p) FOONATHAN_NOEXCEPT
+        {
+            return read_le(p, 8u);
+        }
+
+        FOONATHAN_CONSTEXPR_FNC uint64_t read32(const char* p) FOONATHAN_NOEXCEPT
+        {
+            return read_le(p, 4u);
+        }
+
+        // 64x64 -> 128 bit multiplication, lo and hi are the two halves
+        FOONATHAN_CONSTEXPR_FNC void mul128(uint64_t a, uint64_t b, uint64_t& lo, uint64_t& hi) FOONATHAN_NOEXCEPT
+        {
+#if defined(__SIZEOF_INT128__)
+            if (!std::is_constant_evaluated())
+            {
+                // __extension__ silences -Wpedantic about the non-standard type
+                __extension__ typedef unsigned __int128 uint128;
+                auto res = static_cast<uint128>(a) * b;
+                lo       = static_cast<uint64_t>(res);
+                hi       = static_cast<uint64_t>(res >> 64);
+                return;
+            }
+#endif
+            auto lo_lo = (a & 0xFFFFFFFFu) * (b & 0xFFFFFFFFu);
+            auto hi_lo = (a >> 32) * (b & 0xFFFFFFFFu);
+            auto lo_hi = (a & 0xFFFFFFFFu) * (b >> 32);
+            auto hi_hi = (a >> 32) * (b >> 32);
+            auto cross = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFFu) + lo_hi;
+            hi         = (hi_lo >> 32) + (cross >> 32) + hi_hi;
+            lo         = (cross << 32) | (lo_lo & 0xFFFFFFFFu);
+        }
+
+        FOONATHAN_CONSTEXPR_FNC uint64_t mul_fold(uint64_t a, uint64_t b) FOONATHAN_NOEXCEPT
+        {
+            uint64_t lo = 0u, hi = 0u;
+            mul128(a, b, lo, hi);
+            return lo ^ hi;
+        }
+
+        template <typename T>
+        FOONATHAN_CONSTEXPR_FNC T fold(uint64_t hash) FOONATHAN_NOEXCEPT
+        {
+            static_assert(std::is_same<T, uint32_t>::value || std::is_same<T, uint64_t>::value,
+                          "unsupported storage type");
+            return sizeof(T) == sizeof(uint64_t) ? static_cast<T>(hash) : static_cast<T>(hash ^ (hash >> 32));
+        }
+
+        // xxHash3 inspired hash, not compatible with the reference implementation
+        FOONATHAN_CONSTEXPR uint64_t xxh_prime1 = 0x9E3779B185EBCA87ull;
+        FOONATHAN_CONSTEXPR uint64_t xxh_prime2 = 0xC2B2AE3D27D4EB4Full;
+        FOONATHAN_CONSTEXPR uint64_t xxh_prime3 = 0x165667B19E3779F9ull;
+        FOONATHAN_CONSTEXPR uint64_t xxh_secret[8] = {0xbe4ba423396cfeb8ull, 0x1cad21f72c81017cull,
+                                                      0xdb979083e96dd4deull, 0x1f67b3b7a4a44072ull,
+                                                      0x78e5c0cc4ee679cbull, 0x2172ffcc7dd05a82ull,
+                                                      0x8e2443f7744608b8ull, 0x4c263a81e69035e0ull};
+
+        FOONATHAN_CONSTEXPR_FNC uint64_t xxh_avalanche(uint64_t h) FOONATHAN_NOEXCEPT
+        {
+            h ^= h >> 37;
+            h *= 0x165667919E3779F9ull;
+            return h ^ (h >> 32);
+        }
+
+        FOONATHAN_CONSTEXPR_FNC uint64_t xxh_mix16(const char* p, uint64_t k0, uint64_t k1) FOONATHAN_NOEXCEPT
+        {
+            return mul_fold(read64(p) ^ k0, read64(p + 8) ^ k1);
+        }
+
+        FOONATHAN_CONSTEXPR_FNC uint64_t xxh3_hash(const char* p, std::size_t len) FOONATHAN_NOEXCEPT
+        {
+            if (len == 0u)
+                return xxh_avalanche(xxh_secret[0] ^ xxh_secret[1]);
+            else if (len <= 3u)
+            {
+                auto c = (uint64_t(static_cast<unsigned char>(p[0])) << 16)
+                         | (uint64_t(static_cast<unsigned char>(p[len >> 1])) << 24)
+                         | uint64_t(static_cast<unsigned char>(p[len - 1])) | (uint64_t(len) << 8);
+                return xxh_avalanche((c ^ xxh_secret[2]) * xxh_prime1);
+            }
+            else if (len <= 8u)
+            {
+                auto in = read32(p + len - 4) + (read32(p) << 32);
+                auto h  = (in ^ xxh_secret[3]) * xxh_prime2;
+                return xxh_avalanche(h ^ (h >> 35) ^ len);
+            }
+            else if (len <= 16u)
+            {
+                auto lo  = read64(p) ^ xxh_secret[4];
+                auto hi  = read64(p + len - 8) ^ xxh_secret[5];
+                auto acc = len + std::rotl(lo, 13) + hi + mul_fold(lo, hi);
+                return xxh_avalanche(acc);
+            }
+
+            auto acc = len * xxh_prime1;
+            auto i   = 0u;
+            for (; i + 16u < len; i += 16u)
+                acc += xxh_mix16(p + i, xxh_secret[(i / 8u) % 8u], xxh_secret[(i / 8u + 1u) % 8u]);
+            acc += xxh_mix16(p + len - 16, xxh_secret[6], xxh_secret[7]);
+            return xxh_avalanche(acc ^ (acc >> 29) * xxh_prime3);
+        }
+
+        // wyhash inspired hash, not compatible with the reference implementation
+        FOONATHAN_CONSTEXPR uint64_t wyp0 = 0xa0761d6478bd642full;
+        FOONATHAN_CONSTEXPR uint64_t wyp1 = 0xe7037ed1a0b428dbull;
+
+        FOONATHAN_CONSTEXPR_FNC uint64_t wyhash_hash(const char* p, std::size_t len) FOONATHAN_NOEXCEPT
+        {
+            auto     seed = mul_fold(wyp0, wyp1);
+            uint64_t a = 0u, b = 0u;
+            if (len <= 16u)
+            {
+                if (len >= 4u)
+                {
+                    auto offset = (len >> 3) << 2;
+                    a           = (read32(p) << 32) | read32(p + offset);
+                    b           = (read32(p + len - 4) << 32) | read32(p + len - 4 - offset);
+                }
+                else if (len > 0u)
+                    a = (uint64_t(static_cast<unsigned char>(p[0])) << 16)
+                        | (uint64_t(static_cast<unsigned char>(p[len >> 1])) << 8)
+                        | uint64_t(static_cast<unsigned char>(p[len - 1]));
+            }
+            else
+            {
+                auto i = len;
+                for (; i > 16u; i -= 16u, p += 16)
+                    seed = mul_fold(read64(p) ^ wyp1, read64(p + 8) ^ seed);
+                a = read64(p + i - 16);
+                b = read64(p + i - 8);
+            }
+
+            uint64_t lo = 0u, hi = 0u;
+            mul128(a ^ wyp1, b ^ seed, lo, hi);
+            return mul_fold(lo ^ wyp0 ^ len, hi ^ wyp1);
+        }
+
         // FNV-1a 64 bit hash
         FOONATHAN_CONSTEXPR_FNC void sid_hash(const char* str, uint64_t& res, uint64_t hash = fnv_basis)
         {
-            res = FNV1aHash(str, fnv_basis, fnv_prime);
+            res = FNV1aHash(str, hash, fnv_prime);
         }
 
         // FNV-1a 32 bit hash
         FOONATHAN_CONSTEXPR_FNC void sid_hash(const char* str, uint32_t& res, uint32_t hash = FNV_32_BASIS)
         {
-            res = FNV1aHash(str, FNV_32_BASIS, FNV_32_PRIME);
+            res = FNV1aHash(str, hash, FNV_32_PRIME);
+        }
+
+        // FNV-1a 64 bit hash of a string with given length, same result as the constexpr version
+        inline void sid_hash(const char* str, std::size_t length, uint64_t& res, uint64_t hash = fnv_basis) FOONATHAN_NOEXCEPT
+        {
+            res = FNV1aHashN(str, length, hash, fnv_prime);
+        }
+
+        // FNV-1a 32 bit hash of a string with given length, same result as the constexpr version
+        inline void sid_hash(const char* str, std::size_t length, uint32_t& res, uint32_t hash = FNV_32_BASIS) FOONATHAN_NOEXCEPT
+        {
+            res = FNV1aHashN(str, length, hash, FNV_32_PRIME);
         }
     } // namespace detail
+
+    /// \brief A hash policy using FNV-1a.
+    /// \detail A hash policy provides two static member function templates for \c STORAGE_T of \c uint32_t and \c uint64_t:<br>
+    /// \c hash(str, length) is \c constexpr and used for compile-time hashing,
+    /// \c fast_hash(str, length) is used at runtime and must return the same value.<br>
+    /// If the static member \c is_incremental is \c true, it also provides \c append(hash, str, length)
+    /// and \c fast_append(hash, str, length) continuing the hashing of a string with given hash value,
+    /// the result must be the same as hashing the concatenated string.
+    /// This allows hashing ids with a prefix in O(suffix).
+    struct fnv1a_policy
+    {
+        static FOONATHAN_CONSTEXPR bool is_incremental = true;
+
+        template <typename T>
+        static FOONATHAN_CONSTEXPR_FNC T hash(const char* str, std::size_t length) FOONATHAN_NOEXCEPT
+        {
+            return detail::FNV1aHash(str, length, detail::fnv_params<T>::basis, detail::fnv_params<T>::prime);
+        }
+
+        template <typename T>
+        static T fast_hash(const char* str, std::size_t length) FOONATHAN_NOEXCEPT
+        {
+            return detail::FNV1aHashN(str, length, detail::fnv_params<T>::basis, detail::fnv_params<T>::prime);
+        }
+
+        // the state of FNV-1a is the hash value itself
+        template <typename T>
+        static FOONATHAN_CONSTEXPR_FNC T append(T hash, const char* str, std::size_t length) FOONATHAN_NOEXCEPT
+        {
+            return detail::FNV1aHash(str, length, hash, detail::fnv_params<T>::prime);
+        }
+
+        template <typename T>
+        static T fast_append(T hash, const char* str, std::size_t length) FOONATHAN_NOEXCEPT
+        {
+            return detail::FNV1aHashN(str, length, hash, detail::fnv_params<T>::prime);
+        }
+    };
+
+    /// \brief A hash policy using a hash function in the style of xxHash3.
+    /// \detail It processes 16 bytes per step and has a better distribution than FNV-1a.
+    /// The values are not compatible with the reference implementation.
+    struct xxh3_policy
+    {
+        static FOONATHAN_CONSTEXPR bool is_incremental = false;
+
+        template <typename T>
+        static FOONATHAN_CONSTEXPR_FNC T hash(const char* str, std::size_t length) FOONATHAN_NOEXCEPT
+        {
+            return detail::fold<T>(detail::xxh3_hash(str, length));
+        }
+
+        template <typename T>
+        static T fast_hash(const char* str, std::size_t length) FOONATHAN_NOEXCEPT
+        {
+            return hash<T>(str, length);
+        }
+    };
+
+    /// \brief A hash policy using a hash function in the style of wyhash.
+    /// \detail It processes 16 bytes per step with a single multiplication,
+    /// this makes it the fastest policy for long strings.
+    /// The values are not compatible with the reference implementation.
+    struct wyhash_policy
+    {
+        static FOONATHAN_CONSTEXPR bool is_incremental = false;
+
+        template <typename T>
+        static FOONATHAN_CONSTEXPR_FNC T hash(const char* str, std::size_t length) FOONATHAN_NOEXCEPT
+        {
+            return detail::fold<T>(detail::wyhash_hash(str, length));
+        }
+
+        template <typename T>
+        static T fast_hash(const char* str, std::size_t length) FOONATHAN_NOEXCEPT
+        {
+            return hash<T>(str, length);
+        }
+    };
+
+    /// \brief The hash policy used by default and by the literals.
+    typedef fnv1a_policy default_hash_policy;
 }} // foonathan::string_id
 
 #endif // FOONATHAN_STRING_ID_DETAIL_HASH_HPP_INCLUDED
@@ -0,0 +1,329 @@
+// Copyright (C) 2014-2015 Jonathan Müller <jonathanmueller.dev@gmail.com>
+// This file is subject to the license terms in the LICENSE file
+// found in the top-level directory of this distribution.
+
+#ifndef FOONATHAN_STRING_ID_MAPPED_DATABASE_HPP_INCLUDED
+#define FOONATHAN_STRING_ID_MAPPED_DATABASE_HPP_INCLUDED
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "basic_database.hpp"
+#include "config.hpp"
+#include "database.hpp"
+#include "error.hpp"
+
+namespace foonathan { namespace string_id
+{
+    /// \brief The exception class thrown when a snapshot file can't be read or written.
+    class snapshot_error : public error
+    {
+    public:
+        //=== constructor/destructor ===//
+        /// \brief Creates it by giving it the path of the file and a description of the problem.
+        snapshot_error(const char* path, const char* reason)
+        : path_(path), what_("foonathan::string_id::snapshot_error: snapshot \"" + path_ + "\": " + reason) {}
+
+        ~snapshot_error() FOONATHAN_NOEXCEPT FOONATHAN_OVERRIDE {}
+
+        //=== accessors ===//
+        const char* what() const FOONATHAN_NOEXCEPT FOONATHAN_OVERRIDE;
+
+        /// \brief Returns the path of the snapshot file.
+        const char* path() const FOONATHAN_NOEXCEPT
+        {
+            return path_.c_str();
+        }
+
+    private:
+        std::string path_, what_;
+    };
+
+    /// \brief A read-only memory mapping of a whole file.
+    /// \detail It is used by \ref mapped_database.
+    class mapped_file
+    {
+    public:
+        /// \brief Creates an empty mapping.
+        mapped_file() FOONATHAN_NOEXCEPT;
+
+        /// \brief Maps the given file.
+        /// \throws \ref snapshot_error if the file can't be opened or mapped.
+        explicit mapped_file(const char* path);
+
+        mapped_file(mapped_file&& other) FOONATHAN_NOEXCEPT;
+
+        ~mapped_file() FOONATHAN_NOEXCEPT;
+
+        mapped_file& operator=(mapped_file&& other) FOONATHAN_NOEXCEPT;
+
+        /// \brief Returns the memory of the file, it is aligned to a page boundary.
+        const char* data() const FOONATHAN_NOEXCEPT
+        {
+            return data_;
+        }
+
+        /// \brief Returns the size of the file.
+        std::size_t size() const FOONATHAN_NOEXCEPT
+        {
+            return size_;
+        }
+
+    private:
+        void unmap() FOONATHAN_NOEXCEPT;
+
+        const char* data_;
+        std::size_t size_;
+    };
+
+    /// \cond impl
+    namespace detail
+    {
+        // layout of a snapshot file:
+        // header, sorted hashes, offsets of the strings in the blob, blob of null-terminated strings
+        // each part starts at a multiple of 8
+        struct snapshot_header
+        {
+            char          magic[8];
+            std::uint32_t version;
+            std::uint32_t storage_size;
+            std::uint64_t no_strings;
+            std::uint64_t blob_size;
+        };
+
+        FOONATHAN_CONSTEXPR inline char snapshot_magic[8] = {'S', 'I', 'D', 'S', 'N', 'A', 'P', '\0'};
+        FOONATHAN_CONSTEXPR inline std::uint32_t snapshot_version = 1u;
+
+        inline std::size_t snapshot_align(std::size_t offset) FOONATHAN_NOEXCEPT
+        {
+            return (offset + 7u) & ~std::size_t(7u);
+        }
+
+        inline std::size_t snapshot_offsets_pos(std::size_t no_strings, std::size_t storage_size) FOONATHAN_NOEXCEPT
+        {
+            return snapshot_align(sizeof(snapshot_header) + no_strings * storage_size);
+        }
+
+        inline std::size_t snapshot_blob_pos(std::size_t no_strings, std::size_t storage_size) FOONATHAN_NOEXCEPT
+        {
+            return snapshot_offsets_pos(no_strings, storage_size) + no_strings * sizeof(std::uint64_t);
+        }
+
+        // validates the file and returns the header
+        // the hashes must be strictly ascending and each offset must start a null-terminated string in the blob
+        const snapshot_header& check_snapshot(const mapped_file& file, const char* path, std::size_t storage_size);
+
+        // writes a snapshot from sorted hashes, offsets and blob
+        void write_snapshot(const char* path, std::size_t storage_size,
+                            const void* hashes, std::size_t no_strings,
+                            const std::uint64_t* offsets, const std::string& blob);
+
+        template <typename STORAGE_T>
+        struct snapshot_entry
+        {
+            STORAGE_T   hash;
+            string_info str;
+        };
+
+        template <typename STORAGE_T>
+        bool snapshot_entry_less(const snapshot_entry<STORAGE_T>& a, const snapshot_entry<STORAGE_T>& b) FOONATHAN_NOEXCEPT
+        {
+            return a.hash < b.hash;
+        }
+
+        // writes a snapshot from entries sorted by hash, duplicates are removed
+        template <typename STORAGE_T>
+        std::size_t write_snapshot(const char* path, std::span<const snapshot_entry<STORAGE_T>> entries)
+        {
+            std::vector<STORAGE_T>     hashes;
+            std::vector<std::uint64_t> offsets;
+            std::string                blob;
+            for (auto& e : entries)
+            {
+                if (!hashes.empty() && hashes.back() == e.hash)
+                {
+                    auto prev = blob.c_str() + offsets.back();
+                    if (!strequal(e.str.string, e.str.length, prev))
+                        get_collision_handler<STORAGE_T>()(e.hash, std::string(e.str.string, e.str.length).c_str(),
+                                                           prev);
+                    continue;
+                }
+                hashes.push_back(e.hash);
+                offsets.push_back(blob.size());
+                blob.append(e.str.string, e.str.length);
+                blob.push_back('\0');
+            }
+
+            write_snapshot(path, sizeof(STORAGE_T), hashes.data(), hashes.size(), offsets.data(), blob);
+            return hashes.size();
+        }
+    } // namespace detail
+    /// \endcond
+
+    /// \brief Writes a snapshot file that can be loaded by \ref mapped_database.
+    /// \detail The strings are hashed with \c HashPolicy, it must be the same as the one of the \ref string_id
+    /// using the database. Duplicate strings are stored only once,
+    /// for two different strings with the same hash the \ref collision_handler is called.
+    /// \return The number of strings written.
+    /// \throws \ref snapshot_error if the file can't be written.
+    template <typename STORAGE_T, class HashPolicy = default_hash_policy>
+    std::size_t write_snapshot(const char* path, std::span<const string_info> strs)
+    {
+        std::vector<detail::snapshot_entry<STORAGE_T>> entries;
+        entries.reserve(strs.size());
+        for (auto& str : strs)
+            entries.push_back({HashPolicy::template fast_hash<STORAGE_T>(str.string, str.length), str});
+        std::sort(entries.begin(), entries.end(), detail::snapshot_entry_less<STORAGE_T>);
+        return detail::write_snapshot<STORAGE_T>(path, entries);
+    }
+
+    /// \brief A database that uses a prebuilt snapshot file mapped into memory.
+    /// \detail The snapshot is created via \ref write_snapshot(), e.g. by the tool \c foonathan_string_id_snapshot.
+    /// Lookups of strings in the snapshot return pointers directly into the mapping,
+    /// so loading it only validates the sorted hashes and the offsets of the strings, which are neither copied nor hashed.<br>
+    /// Strings that are not in the snapshot are inserted into an overlay database of type \c Overlay.
+    /// \c open() should be called before any string is inserted,
+    /// otherwise collisions between the overlay and the snapshot are not detected.
+    template <typename STORAGE_T, class Overlay = map_database<STORAGE_T>>
+    class mapped_database : public basic_database<STORAGE_T>
+    {
+    public:
+        /// \brief The type of the overlay database.
+        typedef Overlay overlay_type;
+
+        // a prefix may be in the overlay
+        static FOONATHAN_CONSTEXPR bool stores_strings = detail::database_stores_strings<Overlay>::value;
+
+        /// \brief Creates a database without a snapshot, i.e. only the overlay is used.
+        mapped_database() = default;
+
+        /// \brief Creates a database using the given snapshot file.
+        /// \throws \ref snapshot_error if the file can't be loaded.
+        explicit mapped_database(const char* path)
+        {
+            open(path);
+        }
+
+        /// \brief Maps the given snapshot file.
+        /// \throws \ref snapshot_error if the file can't be loaded.
+        void open(const char* path)
+        {
+            mapped_file file(path);
+            auto& header = detail::check_snapshot(file, path, sizeof(STORAGE_T));
+            no_strings_  = header.no_strings;
+            hashes_      = reinterpret_cast<const STORAGE_T*>(file.data() + sizeof(detail::snapshot_header));
+            offsets_     = reinterpret_cast<const std::uint64_t*>(file.data()
+                                                                   + detail::snapshot_offsets_pos(no_strings_, sizeof(STORAGE_T)));
+            blob_        = file.data() + detail::snapshot_blob_pos(no_strings_, sizeof(STORAGE_T));
+            blob_size_   = header.blob_size;
+            file_        = std::move(file);
+        }
+
+        insert_status insert(STORAGE_T hash, const char* str, std::size_t length) FOONATHAN_OVERRIDE
+        {
+            if (auto snapshot_str = find(hash))
+                return strequal(str, length, snapshot_str) ? insert_status::old_string : insert_status::collision;
+            return overlay_.Overlay::insert(hash, str, length);
+        }
+
+        insert_status insert_verify(STORAGE_T hash, const char* str, std::size_t length,
+                                    verify_level level) FOONATHAN_OVERRIDE
+        {
+            if (auto snapshot_str = find(hash))
+                return level != verify_level::full || strequal(str, length, snapshot_str) ? insert_status::old_string
+                                                                                          : insert_status::collision;
+            return overlay_.Overlay::insert_verify(hash, str, length, level);
+        }
+
+        insert_status insert_prefix(STORAGE_T hash, STORAGE_T prefix, const char* str, std::size_t length) FOONATHAN_OVERRIDE
+        {
+            auto prefix_str = find(prefix);
+            if (!prefix_str)
+            {
+                // the prefix is in the overlay
+                if (!find(hash))
+                    return overlay_.Overlay::insert_prefix(hash, prefix, str, length);
+                prefix_str = overlay_.Overlay::lookup(prefix);
+            }
+            std::string full(prefix_str);
+            full.append(str, length);
+            return insert(hash, full.c_str(), full.size());
+        }
+
+        const char* lookup(STORAGE_T hash) const FOONATHAN_NOEXCEPT FOONATHAN_OVERRIDE
+        {
+            if (auto snapshot_str = find(hash))
+                return snapshot_str;
+            return overlay_.Overlay::lookup(hash);
+        }
+
+        /// \brief Returns the string together with its length.
+        /// \detail For strings of the snapshot it is computed from the offsets.
+        std::string_view lookup_view(STORAGE_T hash) const FOONATHAN_NOEXCEPT FOONATHAN_OVERRIDE
+        {
+            auto index = find_index(hash);
+            if (index == no_strings_)
+                return overlay_.Overlay::lookup_view(hash);
+            auto next = index + 1u == no_strings_ ? blob_size_ : offsets_[index + 1u];
+            return {blob_ + offsets_[index], std::size_t(next - offsets_[index] - 1u)};
+        }
+
+        /// \brief Returns the statistics of the overlay, the strings of the snapshot are added to the items and bytes.
+        database_stats stats() const FOONATHAN_OVERRIDE
+        {
+            auto result = overlay_.Overlay::stats();
+            result.no_items += no_strings_;
+            if (no_strings_)
+                result.string_bytes += file_.size() - detail::snapshot_blob_pos(no_strings_, sizeof(STORAGE_T));
+            return result;
+        }
+
+        /// \brief Returns the number of strings in the snapshot.
+        std::size_t snapshot_size() const FOONATHAN_NOEXCEPT
+        {
+            return no_strings_;
+        }
+
+        /// \brief Returns a reference to the overlay database.
+        overlay_type& overlay() FOONATHAN_NOEXCEPT
+        {
+            return overlay_;
+        }
+
+        const overlay_type& overlay() const FOONATHAN_NOEXCEPT
+        {
+            return overlay_;
+        }
+
+    private:
+        // returns the index of the string in the snapshot or no_strings_
+        std::size_t find_index(STORAGE_T hash) const FOONATHAN_NOEXCEPT
+        {
+            auto end = hashes_ + no_strings_;
+            auto ptr = std::lower_bound(hashes_, end, hash);
+            return ptr == end || *ptr != hash ? no_strings_ : std::size_t(ptr - hashes_);
+        }
+
+        // returns the string in the snapshot or nullptr
+        const char* find(STORAGE_T hash) const FOONATHAN_NOEXCEPT
+        {
+            auto index = find_index(hash);
+            return index == no_strings_ ? nullptr : blob_ + offsets_[index];
+        }
+
+        mapped_file          file_;
+        const STORAGE_T*     hashes_     = nullptr;
+        const std::uint64_t* offsets_    = nullptr;
+        const char*          blob_       = nullptr;
+        std::size_t          blob_size_  = 0u;
+        std::size_t          no_strings_ = 0u;
+        overlay_type         overlay_; // calls are qualified to avoid virtual dispatch
+    };
+}} // namespace foonathan::string_id
+
+#endif // FOONATHAN_STRING_ID_MAPPED_DATABASE_HPP_INCLUDED
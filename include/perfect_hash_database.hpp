@@ -0,0 +1,298 @@
+// Copyright (C) 2014-2015 Jonathan Müller <jonathanmueller.dev@gmail.com>
+// This file is subject to the license terms in the LICENSE file
+// found in the top-level directory of this distribution.
+
+#ifndef FOONATHAN_STRING_ID_PERFECT_HASH_DATABASE_HPP_INCLUDED
+#define FOONATHAN_STRING_ID_PERFECT_HASH_DATABASE_HPP_INCLUDED
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#include "basic_database.hpp"
+#include "config.hpp"
+#include "database.hpp"
+#include "hash.hpp"
+
+namespace foonathan { namespace string_id
+{
+    /// \cond impl
+    namespace detail
+    {
+        FOONATHAN_CONSTEXPR inline std::uint32_t phash_max_seed = 1u << 20;
+
+        // slot of a hash in a table of given size, the seed is the displacement of its bucket
+        template <typename STORAGE_T>
+        FOONATHAN_CONSTEXPR_FNC std::size_t phash_slot(STORAGE_T hash, std::uint32_t seed, std::size_t size) FOONATHAN_NOEXCEPT
+        {
+            auto x = std::uint64_t(hash) ^ (std::uint64_t(seed) * 0x9E3779B97F4A7C15ull);
+            x ^= x >> 33;
+            x *= 0xFF51AFD7ED558CCDull;
+            x ^= x >> 33;
+            return static_cast<std::size_t>(x % size);
+        }
+
+        FOONATHAN_CONSTEXPR_FNC std::size_t phash_strlen(const char* str) FOONATHAN_NOEXCEPT
+        {
+            std::size_t length = 0u;
+            while (str[length])
+                ++length;
+            return length;
+        }
+    } // namespace detail
+    /// \endcond
+
+    /// \brief A minimal perfect hash table mapping hashes of a fixed set of strings to the strings.
+    /// \detail It is created at compile-time by \ref make_perfect_hash_table() via hash and displace:
+    /// the hashes are distributed into buckets and for each bucket a displacement is searched
+    /// so that all its hashes land in free slots.
+    /// A lookup needs at most one comparison and no memory is needed besides the table.
+    template <typename STORAGE_T, std::size_t N>
+    class perfect_hash_table
+    {
+        static_assert(N > 0u, "perfect hash table must not be empty");
+
+    public:
+        /// \brief The type of the hash values.
+        typedef STORAGE_T storage_type;
+
+        /// \brief The number of buckets that get their own displacement.
+        static FOONATHAN_CONSTEXPR std::size_t no_buckets = N / 2u + 1u;
+
+        /// \brief Returns the number of strings.
+        static FOONATHAN_CONSTEXPR_FNC std::size_t size() FOONATHAN_NOEXCEPT
+        {
+            return N;
+        }
+
+        /// \brief Returns the string with given hash or \c nullptr if it isn't stored.
+        FOONATHAN_CONSTEXPR_FNC const char* lookup(STORAGE_T hash) const FOONATHAN_NOEXCEPT
+        {
+            auto slot = detail::phash_slot(hash, seeds_[hash % no_buckets], N);
+            return hashes_[slot] == hash ? strings_[slot] : nullptr;
+        }
+
+        /// \brief Returns the string with given hash together with its length or an empty view if it isn't stored.
+        FOONATHAN_CONSTEXPR_FNC std::string_view lookup_view(STORAGE_T hash) const FOONATHAN_NOEXCEPT
+        {
+            auto slot = detail::phash_slot(hash, seeds_[hash % no_buckets], N);
+            return hashes_[slot] == hash ? std::string_view(strings_[slot], lengths_[slot]) : std::string_view();
+        }
+
+        /// \brief Returns whether or not the table contains a string with given hash.
+        FOONATHAN_CONSTEXPR_FNC bool contains(STORAGE_T hash) const FOONATHAN_NOEXCEPT
+        {
+            return lookup(hash) != nullptr;
+        }
+
+        /// \brief Returns whether or not the table could be created.
+        /// \detail It is \c false if two different strings have the same hash,
+        /// a string was given twice or no displacement was found.
+        FOONATHAN_CONSTEXPR_FNC bool valid() const FOONATHAN_NOEXCEPT
+        {
+            return valid_;
+        }
+
+        /// \brief Returns the first string whose hash collided or was a duplicate, \c nullptr if there was none.
+        FOONATHAN_CONSTEXPR_FNC const char* collision() const FOONATHAN_NOEXCEPT
+        {
+            return collision_;
+        }
+
+    private:
+        FOONATHAN_CONSTEXPR_FNC perfect_hash_table() FOONATHAN_NOEXCEPT
+        : hashes_(), strings_(), lengths_(), seeds_(), collision_(nullptr), valid_(false) {}
+
+        std::array<STORAGE_T, N>                 hashes_;
+        std::array<const char*, N>               strings_;
+        std::array<std::size_t, N>               lengths_;
+        std::array<std::uint32_t, no_buckets>    seeds_;
+        const char*                              collision_;
+        bool                                     valid_;
+
+        template <typename T, class HashPolicy, std::size_t M>
+        friend FOONATHAN_CONSTEXPR_FNC perfect_hash_table<T, M> make_perfect_hash_table(const char* const (&strs)[M]);
+    };
+
+    /// \brief Creates a \ref perfect_hash_table for the given strings at compile-time.
+    /// \detail The strings are hashed with \c HashPolicy, it must be the same as the one of the \ref string_id.<br>
+    /// The strings must be string literals or other strings with static storage duration.
+    template <typename STORAGE_T, class HashPolicy = default_hash_policy, std::size_t N>
+    FOONATHAN_CONSTEXPR_FNC perfect_hash_table<STORAGE_T, N> make_perfect_hash_table(const char* const (&strs)[N])
+    {
+        using table_type = perfect_hash_table<STORAGE_T, N>;
+        FOONATHAN_CONSTEXPR auto no_buckets = table_type::no_buckets;
+
+        table_type table;
+        std::array<STORAGE_T, N>   hashes{};
+        std::array<std::size_t, N> lengths{};
+        for (std::size_t i = 0u; i != N; ++i)
+        {
+            lengths[i] = detail::phash_strlen(strs[i]);
+            hashes[i]  = HashPolicy::template hash<STORAGE_T>(strs[i], lengths[i]);
+        }
+
+        // duplicate hashes can't be placed
+        std::array<std::size_t, N> sorted{};
+        for (std::size_t i = 0u; i != N; ++i)
+            sorted[i] = i;
+        std::sort(sorted.begin(), sorted.end(),
+                  [&](std::size_t a, std::size_t b) { return hashes[a] < hashes[b]; });
+        for (std::size_t i = 1u; i < N; ++i)
+            if (hashes[sorted[i - 1]] == hashes[sorted[i]])
+            {
+                table.collision_ = strs[sorted[i]];
+                return table;
+            }
+
+        // group the hashes by bucket via counting sort
+        std::array<std::size_t, no_buckets + 1u> bucket_begin{};
+        for (auto hash : hashes)
+            ++bucket_begin[hash % no_buckets + 1u];
+        for (std::size_t i = 0u; i != no_buckets; ++i)
+            bucket_begin[i + 1u] += bucket_begin[i];
+        std::array<std::size_t, N>          members{};
+        std::array<std::size_t, no_buckets> no_members{};
+        for (std::size_t i = 0u; i != N; ++i)
+        {
+            auto bucket = hashes[i] % no_buckets;
+            members[bucket_begin[bucket] + no_members[bucket]++] = i;
+        }
+
+        // place the biggest buckets first while there are many free slots
+        std::array<std::size_t, no_buckets> buckets{};
+        for (std::size_t i = 0u; i != no_buckets; ++i)
+            buckets[i] = i;
+        std::sort(buckets.begin(), buckets.end(),
+                  [&](std::size_t a, std::size_t b) { return no_members[a] > no_members[b]; });
+
+        std::array<bool, N>        used{};
+        std::array<std::size_t, N> slots{};
+        for (auto bucket : buckets)
+        {
+            auto begin = members.begin() + bucket_begin[bucket], end = begin + no_members[bucket];
+            if (begin == end)
+                break;
+
+            auto found = false;
+            for (std::uint32_t seed = 0u; !found && seed != detail::phash_max_seed; ++seed)
+            {
+                found = true;
+                auto slots_end = slots.begin();
+                for (auto cur = begin; found && cur != end; ++cur)
+                {
+                    auto slot    = detail::phash_slot(hashes[*cur], seed, N);
+                    found        = !used[slot] && std::find(slots.begin(), slots_end, slot) == slots_end;
+                    *slots_end++ = slot;
+                }
+                if (!found)
+                    continue;
+
+                table.seeds_[bucket] = seed;
+                for (auto cur = begin; cur != end; ++cur)
+                {
+                    auto slot            = detail::phash_slot(hashes[*cur], seed, N);
+                    used[slot]           = true;
+                    table.hashes_[slot]  = hashes[*cur];
+                    table.strings_[slot] = strs[*cur];
+                    table.lengths_[slot] = lengths[*cur];
+                }
+            }
+            if (!found)
+                return table;
+        }
+
+        table.valid_ = true;
+        return table;
+    }
+
+    /// \brief A read-only database using a \ref perfect_hash_table created at compile-time.
+    /// \detail \c Table must be a reference to a \c constexpr \ref perfect_hash_table,
+    /// it is checked via \c static_assert that it could be created without collisions.
+    /// Inserting a string of the table neither allocates nor copies it.
+    /// Other strings are inserted into an overlay database of type \c Overlay,
+    /// it can be \ref dummy_database to not store them at all.
+    template <const auto& Table,
+              class Overlay = map_database<typename std::remove_cvref_t<decltype(Table)>::storage_type>>
+    class perfect_hash_database
+    : public basic_database<typename std::remove_cvref_t<decltype(Table)>::storage_type>
+    {
+        static_assert(Table.valid(), "collision or duplicate string in perfect hash table");
+
+    public:
+        /// \brief The type of the hash values.
+        typedef typename std::remove_cvref_t<decltype(Table)>::storage_type STORAGE_TYPE;
+
+        /// \brief The type of the overlay database.
+        typedef Overlay overlay_type;
+
+        // a prefix may be in the overlay
+        static FOONATHAN_CONSTEXPR bool stores_strings = detail::database_stores_strings<Overlay>::value;
+
+        insert_status insert(STORAGE_TYPE hash, const char* str, std::size_t length) FOONATHAN_OVERRIDE
+        {
+            if (auto table_str = Table.lookup(hash))
+                return strequal(str, length, table_str) ? insert_status::old_string : insert_status::collision;
+            return overlay_.Overlay::insert(hash, str, length);
+        }
+
+        insert_status insert_verify(STORAGE_TYPE hash, const char* str, std::size_t length,
+                                    verify_level level) FOONATHAN_OVERRIDE
+        {
+            if (auto table_str = Table.lookup(hash))
+                return level != verify_level::full || strequal(str, length, table_str) ? insert_status::old_string
+                                                                                       : insert_status::collision;
+            return overlay_.Overlay::insert_verify(hash, str, length, level);
+        }
+
+        insert_status insert_prefix(STORAGE_TYPE hash, STORAGE_TYPE prefix, const char* str, std::size_t length) FOONATHAN_OVERRIDE
+        {
+            if (!Table.contains(hash) && !Table.contains(prefix))
+                return overlay_.Overlay::insert_prefix(hash, prefix, str, length);
+            std::string full(lookup(prefix));
+            full.append(str, length);
+            return insert(hash, full.c_str(), full.size());
+        }
+
+        const char* lookup(STORAGE_TYPE hash) const FOONATHAN_NOEXCEPT FOONATHAN_OVERRIDE
+        {
+            if (auto table_str = Table.lookup(hash))
+                return table_str;
+            return overlay_.Overlay::lookup(hash);
+        }
+
+        std::string_view lookup_view(STORAGE_TYPE hash) const FOONATHAN_NOEXCEPT FOONATHAN_OVERRIDE
+        {
+            if (auto table_str = Table.lookup_view(hash); table_str.data())
+                return table_str;
+            return overlay_.Overlay::lookup_view(hash);
+        }
+
+        /// \brief Returns the statistics of the overlay, the strings of the table are added to the items.
+        database_stats stats() const FOONATHAN_OVERRIDE
+        {
+            auto result = overlay_.Overlay::stats();
+            result.no_items += Table.size();
+            return result;
+        }
+
+        /// \brief Returns a reference to the overlay database.
+        overlay_type& overlay() FOONATHAN_NOEXCEPT
+        {
+            return overlay_;
+        }
+
+        const overlay_type& overlay() const FOONATHAN_NOEXCEPT
+        {
+            return overlay_;
+        }
+
+    private:
+        overlay_type overlay_; // calls are qualified to avoid virtual dispatch
+    };
+}} // namespace foonathan::string_id
+
+#endif // FOONATHAN_STRING_ID_PERFECT_HASH_DATABASE_HPP_INCLUDED
@@ -0,0 +1,138 @@
+// Copyright (C) 2014-2015 Jonathan Müller <jonathanmueller.dev@gmail.com>
+// This file is subject to the license terms in the LICENSE file
+// found in the top-level directory of this distribution.
+
+#ifndef FOONATHAN_STRING_ID_REGISTERED_DATABASE_HPP_INCLUDED
+#define FOONATHAN_STRING_ID_REGISTERED_DATABASE_HPP_INCLUDED
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "config.hpp"
+#include "error.hpp"
+
+namespace foonathan { namespace string_id
+{
+    /// \brief The exception class thrown when too many \ref registered_database objects exist.
+    class database_registry_error : public error
+    {
+    public:
+        //=== constructor/destructor ===//
+        /// \brief Creates it by giving it the maximum number of databases.
+        database_registry_error(std::size_t max_instances)
+        : what_("foonathan::string_id::database_registry_error: more than " + std::to_string(max_instances - 1u) +
+                " databases registered"), max_(max_instances) {}
+
+        ~database_registry_error() FOONATHAN_NOEXCEPT FOONATHAN_OVERRIDE {}
+
+        //=== accessors ===//
+        const char* what() const FOONATHAN_NOEXCEPT FOONATHAN_OVERRIDE;
+
+        /// \brief Returns the maximum number of databases, including the default instance.
+        std::size_t max_instances() const FOONATHAN_NOEXCEPT
+        {
+            return max_;
+        }
+
+    private:
+        std::string what_;
+        std::size_t max_;
+    };
+
+    /// \brief An adapter for other databases which registers each object in a registry.
+    /// \detail A \ref string_id using this database stores a small index into the registry
+    /// instead of using one database shared by all ids,
+    /// so ids can be created in a given database instance, e.g. for each level or worker.
+    /// Destroying the database releases all its strings at once,
+    /// ids of it must not be used afterwards since its index may be reused.<br>
+    /// Index \c 0 is a default instance that is used by the constructors of \ref string_id without a database.
+    /// At most \c MaxInstances databases, including the default instance, can exist at the same time.<br>
+    /// The index is stored next to the hash, so with padding an id is twice as big as its hash,
+    /// e.g. 8 bytes for \c std::uint32_t and 16 bytes for \c std::uint64_t.
+    template <class Database, std::size_t MaxInstances = 256u>
+    class registered_database : public Database
+    {
+        static_assert(MaxInstances > 1u && MaxInstances <= 65536u, "invalid number of instances");
+
+    public:
+        /// \brief The base database.
+        typedef Database base_database;
+
+        /// \brief The type of the index stored in the ids.
+        typedef std::uint16_t index_type;
+
+        // marks the database for string_id
+        static FOONATHAN_CONSTEXPR bool is_registered_database = true;
+
+        /// \brief Creates and registers a new database.
+        /// \detail The arguments are forwarded to the base database.
+        /// It doesn't take another \ref registered_database, the database can't be copied.
+        /// \throws \ref database_registry_error if there are too many databases.
+        template <typename ... Args>
+            requires (!(sizeof...(Args) == 1u && (std::is_same_v<std::remove_cvref_t<Args>, registered_database> && ...)))
+        explicit registered_database(Args&&... args)
+        : base_database(std::forward<Args>(args)...), index_(acquire(this)) {}
+
+        registered_database(const registered_database&) = delete;
+        registered_database& operator=(const registered_database&) = delete;
+
+        ~registered_database() FOONATHAN_NOEXCEPT
+        {
+            if (index_ != 0u)
+                registry_[index_].store(nullptr, std::memory_order_release);
+        }
+
+        /// \brief Returns the index of this database.
+        index_type index() const FOONATHAN_NOEXCEPT
+        {
+            return index_;
+        }
+
+        /// \brief Returns the database with the given index, it must exist.
+        static registered_database& get(index_type index) FOONATHAN_NOEXCEPT
+        {
+            if (index == 0u)
+                return default_instance();
+            auto db = registry_[index].load(std::memory_order_acquire);
+            assert(db && "database does not exist anymore");
+            return *db;
+        }
+
+        /// \brief Returns the default instance with index \c 0.
+        static registered_database& default_instance() FOONATHAN_NOEXCEPT
+        {
+            static registered_database db(default_tag{});
+            return db;
+        }
+
+    private:
+        struct default_tag {};
+
+        explicit registered_database(default_tag)
+        : base_database(), index_(0u) {}
+
+        static index_type acquire(registered_database* db)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (std::size_t i = 1u; i != MaxInstances; ++i)
+                if (!registry_[i].load(std::memory_order_relaxed))
+                {
+                    registry_[i].store(db, std::memory_order_release);
+                    return static_cast<index_type>(i);
+                }
+            throw database_registry_error(MaxInstances);
+        }
+
+        index_type index_;
+
+        static inline std::atomic<registered_database*> registry_[MaxInstances] = {};
+        static inline std::mutex                        mutex_;
+    };
+}} // namespace foonathan::string_id
+
+#endif // FOONATHAN_STRING_ID_REGISTERED_DATABASE_HPP_INCLUDED
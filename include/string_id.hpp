@@ -5,8 +5,13 @@
 #ifndef FOONATHAN_STRING_ID_HPP_INCLUDED
 #define FOONATHAN_STRING_ID_HPP_INCLUDED
 
+#include <atomic>
 #include <cstring>
 #include <functional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
 
 #include "basic_database.hpp"
 #include "config.hpp"
@@ -15,45 +20,161 @@
 
 namespace foonathan { namespace string_id
 {
-    /// \brief Information about a string.
-    /// \detail It is used to reduce the number of constructors of \ref string_id.
-    struct string_info
-    {
-        /// \brief A pointer to a null-terminated string.
-        const char *string;
-        /// \brief The length of this string.
-        std::size_t length;
-        
-        /// \brief Creates it from a null-terminated string (implicit conversion).
-        string_info(const char *str) FOONATHAN_NOEXCEPT
-        : string(str), length(std::strlen(str)) {}
-        
-        /// \brief Creates it from a string with given length.
-        /// \arg \c str does not need to be null-terminated.
-        string_info(const char *str, std::size_t length)
-        : string(str), length(length) {}
+    /// \brief A string that can be used as template argument, e.g. of \c string_id::literal().
+    /// \detail It is implicitly created from a string literal.
+    template <std::size_t N>
+    struct fixed_string
+    {
+        char str[N];
+
+        FOONATHAN_CONSTEXPR_FNC fixed_string(const char (&s)[N]) FOONATHAN_NOEXCEPT
+        : str()
+        {
+            for (std::size_t i = 0u; i != N; ++i)
+                str[i] = s[i];
+        }
+
+        /// \brief Returns the null-terminated string.
+        FOONATHAN_CONSTEXPR_FNC const char* c_str() const FOONATHAN_NOEXCEPT
+        {
+            return str;
+        }
+
+        /// \brief Returns the length of the string without the null terminator.
+        FOONATHAN_CONSTEXPR_FNC std::size_t size() const FOONATHAN_NOEXCEPT
+        {
+            return N - 1u;
+        }
     };
-    
+
+    /// \cond impl
+    namespace detail
+    {
+        // side table of strings for debuggers, see string_id.natvis
+        // it is direct-mapped, so only the most recent ids are guaranteed to be found
+        template <typename STORAGE_T>
+        struct debug_entry
+        {
+            std::atomic<STORAGE_T>   hash;
+            std::atomic<const char*> str;
+        };
+
+        FOONATHAN_CONSTEXPR inline std::size_t debug_table_size = 4096u;
+
+        template <typename STORAGE_T>
+        inline debug_entry<STORAGE_T> debug_table[debug_table_size];
+
+        template <typename STORAGE_T>
+        void register_debug_string(STORAGE_T hash, const char* str) FOONATHAN_NOEXCEPT
+        {
+            auto& entry = debug_table<STORAGE_T>[hash % debug_table_size];
+            entry.str.store(str, std::memory_order_relaxed);
+            entry.hash.store(hash, std::memory_order_relaxed);
+        }
+
+        // returns the string of the hash if it is in the side table, nullptr otherwise
+        template <typename STORAGE_T>
+        const char* debug_string(STORAGE_T hash) FOONATHAN_NOEXCEPT
+        {
+            auto& entry = debug_table<STORAGE_T>[hash % debug_table_size];
+            return entry.hash.load(std::memory_order_relaxed) == hash ? entry.str.load(std::memory_order_relaxed)
+                                                                       : nullptr;
+        }
+
+        // the database of a string_id: one static database shared by all ids
+        template <class Database, bool Registered = requires { Database::is_registered_database; }>
+        class database_ref
+        {
+        public:
+            static FOONATHAN_CONSTEXPR bool is_registered = false;
+
+            Database& get() const FOONATHAN_NOEXCEPT
+            {
+                return db_;
+            }
+
+            bool same_database(const database_ref&) const FOONATHAN_NOEXCEPT
+            {
+                return true;
+            }
+
+        private:
+            // db_ is exactly of type Database,
+            // so all calls are qualified to avoid the virtual dispatch and allow inlining
+            static inline Database db_;
+        };
+
+        // or an index into the registry of a registered_database
+        template <class Database>
+        class database_ref<Database, true>
+        {
+        public:
+            static FOONATHAN_CONSTEXPR bool is_registered = true;
+
+            database_ref() FOONATHAN_NOEXCEPT : index_(0u) {}
+
+            explicit database_ref(Database& db) FOONATHAN_NOEXCEPT : index_(db.index()) {}
+
+            Database& get() const FOONATHAN_NOEXCEPT
+            {
+                return Database::get(index_);
+            }
+
+            bool same_database(const database_ref& other) const FOONATHAN_NOEXCEPT
+            {
+                return index_ == other.index_;
+            }
+
+        private:
+            typename Database::index_type index_;
+        };
+    } // namespace detail
+    /// \endcond
+
     /// \brief The string identifier class.
     /// \detail This is a lightweight class to store strings.<br>
     /// It only stores a hash of the string allowing fast copying and comparisons.
-    template<typename DATABASE_T, typename STORAGE_T = uint32_t>
-    class string_id
+    /// The hash is computed by \c HashPolicy, see \ref fnv1a_policy.<br>
+    /// It has the same size as \c STORAGE_T,
+    /// unless \c DATABASE_T is a \ref registered_database, then it also stores the index of its database
+    /// and is twice as big due to padding.
+    /// If \ref STRID_DEBUG is \c true, the strings are also put into a side table for debuggers.
+    template<typename DATABASE_T, typename STORAGE_T = uint32_t, class HashPolicy = default_hash_policy>
+    class string_id : detail::database_ref<DATABASE_T>
     {
+        using database_ref = detail::database_ref<DATABASE_T>;
+
     public:
         using DATABASE_TYPE = DATABASE_T;
         using STORAGE_TYPE = STORAGE_T;
+        using HASH_POLICY = HashPolicy;
 
-        string_id() : id_(0) {};
+        string_id() FOONATHAN_NOEXCEPT : id_(0)
+        {
+            static_assert(database_ref::is_registered ? sizeof(string_id) <= 2 * sizeof(STORAGE_T)
+                                                      : sizeof(string_id) == sizeof(STORAGE_T),
+                          "string_id must be as big as its hash, or twice as big with a registered database");
+        }
 
         //=== constructors ===//
         /// \brief Creates a new id by hashing a given string.
         /// \detail It will insert the string into the given \ref database which will copy it.<br>
-        /// If it encounters a collision, the \ref collision_handler will be called.
-        string_id(string_info str);
+        /// If it encounters a collision, the \ref collision_handler will be called.<br>
+        /// For a \ref registered_database it uses the default instance.
+        string_id(string_info str)
+        : string_id(in_database{database_ref()}, str) {}
+
+        /// \brief Creates a new id by hashing a given string and inserting it into the given database.
+        /// \detail This is only available if \c DATABASE_T is a \ref registered_database.<br>
+        /// Otherwise the same as other constructor.
+        string_id(DATABASE_T& db, string_info str) requires database_ref::is_registered
+        : string_id(in_database{database_ref(db)}, str) {}
         
         /// \brief Creates a new id with a given prefix.
-        /// \detail The new id will be inserted into the same database as the prefix.<br>
+        /// \detail The new id will be inserted into the same database as the prefix.
+        /// It has the same value as an id of the concatenated string,
+        /// if the \c HashPolicy is incremental only the suffix needs to be hashed.<br>
+        /// If the database doesn't store strings, the \c HashPolicy must be incremental, this is checked via \c static_assert.<br>
         //// Otherwise the same as other constructor.
         string_id(const string_id &prefix, string_info str);
         
@@ -61,10 +182,145 @@ namespace foonathan { namespace string_id
         /// \brief Sames as other constructor versions but instead of calling the \ref collision_handler,
         /// they set the output parameter to the appropriate status.
         /// \detail This also allows information whether or not the string was already stored inside the database.
-        string_id(string_info str, insert_status& status);
+        string_id(string_info str, insert_status& status)
+        : string_id(in_database{database_ref()}, str, status) {}
+
+        string_id(DATABASE_T& db, string_info str, insert_status& status) requires database_ref::is_registered
+        : string_id(in_database{database_ref(db)}, str, status) {}
                  
         string_id(const string_id& prefix, string_info str, insert_status& status);
         /// @}
+
+        /// @{
+        /// \brief Creates a new id like the constructors with status, but returns the status instead.
+        /// \detail The id is assigned to \c result, it is only usable if the status isn't \ref insert_status::collision.<br>
+        /// Neither the \ref collision_handler is called nor an exception thrown on collision,
+        /// so it is the error channel for code that must neither throw nor allocate on a collision.
+        /// Nothing is allocated unless the database needs to allocate memory for a new string
+        /// or, for the prefix version, the \c HashPolicy isn't incremental.
+        /// The version with a database is only available if \c DATABASE_T is a \ref registered_database.
+        static insert_status try_make(string_info str, string_id& result)
+        {
+            insert_status status;
+            result = string_id(in_database{database_ref()}, str, status);
+            return status;
+        }
+
+        static insert_status try_make(DATABASE_T& db, string_info str, string_id& result)
+            requires database_ref::is_registered
+        {
+            insert_status status;
+            result = string_id(in_database{database_ref(db)}, str, status);
+            return status;
+        }
+
+        static insert_status try_make(const string_id& prefix, string_info str, string_id& result)
+        {
+            insert_status status;
+            result = string_id(prefix, str, status);
+            return status;
+        }
+        /// @}
+
+        /// @{
+        /// \brief Creates a new id by hashing a given string, checking a stored string with the same hash only as given.
+        /// \detail With \ref verify_level::full it is the same as the other constructors.
+        /// With \ref verify_level::hash a stored string with the same hash is not compared,
+        /// a new string is still inserted.
+        /// With \ref verify_level::none the database isn't accessed at all,
+        /// the string must have been inserted before.<br>
+        /// This allows skipping the string comparison for strings from trusted sources.
+        /// Unless \c NDEBUG is defined, \ref verify_level::full is always used to detect collisions.
+        /// The version with a database is only available if \c DATABASE_T is a \ref registered_database.
+        string_id(string_info str, verify_level level)
+        : string_id(in_database{database_ref()}, str, level) {}
+
+        string_id(DATABASE_T& db, string_info str, verify_level level) requires database_ref::is_registered
+        : string_id(in_database{database_ref(db)}, str, level) {}
+        /// @}
+
+        /// @{
+        /// \brief Creates an id from a hash value, e.g. one returned by \c hash_code() of another id.
+        /// \detail The database isn't accessed, the hash must have been inserted before,
+        /// this is asserted unless \c NDEBUG is defined.
+        /// The version with a database is only available if \c DATABASE_T is a \ref registered_database.
+        static string_id from_hash(STORAGE_T hash) FOONATHAN_NOEXCEPT
+        {
+            return string_id(in_database{database_ref()}, hash);
+        }
+
+        static string_id from_hash(DATABASE_T& db, STORAGE_T hash) FOONATHAN_NOEXCEPT
+            requires database_ref::is_registered
+        {
+            return string_id(in_database{database_ref(db)}, hash);
+        }
+        /// @}
+
+        /// @{
+        /// \brief Creates an id of a string known at compile-time, e.g. \c id::literal<"player">().
+        /// \detail The hash is computed at compile-time with \c HashPolicy::hash().
+        /// The first version inserts the string into the database only on its first call,
+        /// later calls just return the same id, this is thread safe.<br>
+        /// The version with a database inserts it on each call without hashing it
+        /// and is only available if \c DATABASE_T is a \ref registered_database.
+        /// If it encounters a collision, the \ref collision_handler will be called.
+        template <fixed_string Str>
+        static string_id literal()
+        {
+            static const string_id id(in_database{database_ref()}, literal_hash<Str>,
+                                      string_info(Str.c_str(), Str.size()));
+            return id;
+        }
+
+        template <fixed_string Str>
+        static string_id literal(DATABASE_T& db) requires database_ref::is_registered
+        {
+            return string_id(in_database{database_ref(db)}, literal_hash<Str>, string_info(Str.c_str(), Str.size()));
+        }
+        /// @}
+
+        /// @{
+        /// \brief Creates ids for multiple strings at once.
+        /// \detail All strings are hashed first and then inserted with a single call to \c insert_batch,
+        /// which allows the database to lock and resize only once.<br>
+        /// \c ids[i] will be the id of \c strs[i].
+        /// The versions without status call the \ref collision_handler, the others set the status instead.
+        /// The versions with a database are only available if \c DATABASE_T is a \ref registered_database.
+        static void make_batch(std::span<const string_info> strs, std::span<string_id> ids)
+        {
+            make_batch(in_database{database_ref()}, strs, ids);
+        }
+
+        static void make_batch(std::span<const string_info> strs, std::span<string_id> ids,
+                               std::span<insert_status> status)
+        {
+            make_batch(in_database{database_ref()}, strs, ids, status);
+        }
+
+        static void make_batch(DATABASE_T& db, std::span<const string_info> strs, std::span<string_id> ids)
+            requires database_ref::is_registered
+        {
+            make_batch(in_database{database_ref(db)}, strs, ids);
+        }
+
+        static void make_batch(DATABASE_T& db, std::span<const string_info> strs, std::span<string_id> ids,
+                               std::span<insert_status> status) requires database_ref::is_registered
+        {
+            make_batch(in_database{database_ref(db)}, strs, ids, status);
+        }
+        /// @}
+
+        /// @{
+        /// \brief Creates ids for multiple strings with the same prefix at once.
+        /// \detail Same as the prefix constructor for each string,
+        /// but the strings are inserted with a single call to \c insert_prefix_batch.<br>
+        /// \c ids[i] will be the id of the prefix followed by \c strs[i].
+        /// The first version calls the \ref collision_handler, the second one sets the status instead.
+        static void make_batch(const string_id& prefix, std::span<const string_info> strs, std::span<string_id> ids);
+
+        static void make_batch(const string_id& prefix, std::span<const string_info> strs, std::span<string_id> ids,
+                               std::span<insert_status> status);
+        /// @}
         
         //=== accessors ===//
         /// \brief Returns the hashed value of the string.
@@ -73,15 +329,26 @@ namespace foonathan { namespace string_id
             return id_;
         }
         
+        /// \brief Returns the hash value a string would have, it can be used in constant expressions.
+        static FOONATHAN_CONSTEXPR_FNC STORAGE_T hash(const char* str, std::size_t length) FOONATHAN_NOEXCEPT
+        {
+            return HashPolicy::template hash<STORAGE_T>(str, length);
+        }
+
         /// \brief Returns a reference to the database.
         DATABASE_T& database() const FOONATHAN_NOEXCEPT
         {
-            return db_;
+            return database_ref::get();
         }
         
         /// \brief Returns the string value itself.
         /// \detail This calls the \c lookup function on the database.
         const char* string() const FOONATHAN_NOEXCEPT;
+
+        /// \brief Returns the string value together with its length.
+        /// \detail This calls the \c lookup_view function on the database,
+        /// so the length doesn't need to be computed if the database stores it.
+        std::string_view string_view() const FOONATHAN_NOEXCEPT;
         
         //=== comparision ===//
         /// @{
@@ -90,7 +357,7 @@ namespace foonathan { namespace string_id
         /// A hashed value is equal to a string id if it is the same value.
         friend bool operator==(string_id a, string_id b) FOONATHAN_NOEXCEPT
         {
-            return a.id_ == b.id_;
+            return a.id_ == b.id_ && a.same_database(b);
         }
         
         friend bool operator==(STORAGE_T a, const string_id& b) FOONATHAN_NOEXCEPT
@@ -125,94 +392,276 @@ namespace foonathan { namespace string_id
         /// @}
         
     private:
-        STORAGE_T id_;
-    #if STRID_DEBUG
-        // TODO: disable any string storage inside nodes in database when STRID_DEBUG is undefined
-        const char* dbgStr;
-    #endif
+        // distinguishes the constructors from the other ones
+        struct in_database
+        {
+            database_ref db;
+        };
+
+        string_id(in_database db, string_info str);
+        string_id(in_database db, string_info str, insert_status& status);
+        string_id(in_database db, string_info str, verify_level level);
+
+        string_id(in_database db, STORAGE_T hash) FOONATHAN_NOEXCEPT
+        : database_ref(db.db), id_(hash)
+        {
+            // the lookup asserts that the hash was inserted
+            assert(database().DATABASE_T::lookup(hash));
+        }
 
-        static inline DATABASE_T db_;
+        // inserts the string with a precomputed hash
+        string_id(in_database db, STORAGE_T hash, string_info str);
+
+        template <fixed_string Str>
+        static FOONATHAN_CONSTEXPR STORAGE_T literal_hash = HashPolicy::template hash<STORAGE_T>(Str.c_str(), Str.size());
+
+        static void make_batch(in_database db, std::span<const string_info> strs, std::span<string_id> ids);
+        static void make_batch(in_database db, std::span<const string_info> strs, std::span<string_id> ids,
+                               std::span<insert_status> status);
+
+        static STORAGE_T hash_prefix(const string_id& prefix, string_info str);
+
+        STORAGE_T id_;
     };
 
     template<typename DATABASE_T, typename STORAGE_T>
-    void handle_collision(DATABASE_T& db, STORAGE_T hash, const char* str)
+    void handle_collision(DATABASE_T& db, STORAGE_T hash, string_info str)
     {
         auto handler = get_collision_handler<STORAGE_T>();
-        auto second  = db.lookup(hash);
-        handler(hash, str, second);
+        auto second  = db.DATABASE_T::lookup(hash);
+        // the string may not be null-terminated, short ones are copied without allocation
+        char buffer[256];
+        if (str.length < sizeof(buffer))
+        {
+            std::memcpy(buffer, str.string, str.length);
+            buffer[str.length] = '\0';
+            handler(hash, buffer, second);
+        }
+        else
+            handler(hash, std::string(str.string, str.length).c_str(), second);
     }
 
-    template<typename DATABASE_T, typename STORAGE_T>
-    string_id<DATABASE_T, STORAGE_T>::string_id(string_info str)
+    template<typename DATABASE_T, typename STORAGE_T, class HashPolicy>
+    string_id<DATABASE_T, STORAGE_T, HashPolicy>::string_id(in_database db, string_info str)
     {
         insert_status status;
-        *this = string_id(str, status);
+        *this = string_id(db, str, status);
         if (status == insert_status::collision)
-            handle_collision(db_, id_, str.string);
+            handle_collision(database(), id_, str);
     }
 
-    template <typename DATABASE_T, typename STORAGE_T>
-    string_id<DATABASE_T, STORAGE_T>::string_id(string_info str, insert_status& status)
+    template <typename DATABASE_T, typename STORAGE_T, class HashPolicy>
+    string_id<DATABASE_T, STORAGE_T, HashPolicy>::string_id(in_database db, string_info str, insert_status& status)
+    : database_ref(db.db)
     {
-        detail::sid_hash(str.string, id_);
-        status = db_.insert(id_, str.string, str.length);
+        id_ = HashPolicy::template fast_hash<STORAGE_T>(str.string, str.length);
+        status = database().DATABASE_T::insert(id_, str.string, str.length);
     #if STRID_DEBUG
         if (status != insert_status::collision)
-            dbgStr = string();
+            detail::register_debug_string(id_, string());
     #endif
     }
 
-    template <typename DATABASE_T, typename STORAGE_T>
-    string_id<DATABASE_T, STORAGE_T>::string_id(const string_id& prefix, string_info str)
+    template <typename DATABASE_T, typename STORAGE_T, class HashPolicy>
+    string_id<DATABASE_T, STORAGE_T, HashPolicy>::string_id(in_database db, string_info str, verify_level level)
+    : database_ref(db.db)
+    {
+    #ifndef NDEBUG
+        level = verify_level::full;
+    #endif
+        id_ = HashPolicy::template fast_hash<STORAGE_T>(str.string, str.length);
+        if (level == verify_level::none)
+            return;
+
+        auto status = level == verify_level::full ? database().DATABASE_T::insert(id_, str.string, str.length)
+                                                  : database().DATABASE_T::insert_verify(id_, str.string, str.length, level);
+        if (status == insert_status::collision)
+            handle_collision(database(), id_, str);
+    #if STRID_DEBUG
+        else
+            detail::register_debug_string(id_, string());
+    #endif
+    }
+
+    template <typename DATABASE_T, typename STORAGE_T, class HashPolicy>
+    string_id<DATABASE_T, STORAGE_T, HashPolicy>::string_id(in_database db, STORAGE_T hash, string_info str)
+    : database_ref(db.db), id_(hash)
+    {
+        assert(id_ == HashPolicy::template fast_hash<STORAGE_T>(str.string, str.length) && "wrong hash");
+        auto status = database().DATABASE_T::insert(id_, str.string, str.length);
+        if (status == insert_status::collision)
+            handle_collision(database(), id_, str);
+    #if STRID_DEBUG
+        else
+            detail::register_debug_string(id_, string());
+    #endif
+    }
+
+    template <typename DATABASE_T, typename STORAGE_T, class HashPolicy>
+    string_id<DATABASE_T, STORAGE_T, HashPolicy>::string_id(const string_id& prefix, string_info str)
     {
         insert_status status;
         *this = string_id(prefix, str, status);
         if (status == insert_status::collision)
-            handle_collision(db_, id_, str.string);
+            handle_collision(database(), id_, str);
     }
 
-    template <typename DATABASE_T, typename STORAGE_T>
-    string_id<DATABASE_T, STORAGE_T>::string_id(const string_id& prefix, string_info str, insert_status& status)
+    template <typename DATABASE_T, typename STORAGE_T, class HashPolicy>
+    string_id<DATABASE_T, STORAGE_T, HashPolicy>::string_id(const string_id& prefix, string_info str, insert_status& status)
+    : database_ref(prefix)
     {
-        detail::sid_hash(str.string, id_, prefix.hash_code());
-        status = db_.insert_prefix(id_, prefix.hash_code(), str.string, str.length);
+        id_ = hash_prefix(prefix, str);
+        status = database().DATABASE_T::insert_prefix(id_, prefix.hash_code(), str.string, str.length);
     #if STRID_DEBUG
         if (status != insert_status::collision)
-            dbgStr = string();
+            detail::register_debug_string(id_, string());
     #endif
     }
 
-    template <typename DATABASE_T, typename STORAGE_T>
-    const char* string_id<DATABASE_T, STORAGE_T>::string() const FOONATHAN_NOEXCEPT
+    template <typename DATABASE_T, typename STORAGE_T, class HashPolicy>
+    void string_id<DATABASE_T, STORAGE_T, HashPolicy>::make_batch(in_database db, std::span<const string_info> strs,
+                                                                 std::span<string_id> ids)
+    {
+        std::vector<insert_status> status(strs.size());
+        make_batch(db, strs, ids, status);
+        for (std::size_t i = 0u; i != strs.size(); ++i)
+            if (status[i] == insert_status::collision)
+                handle_collision(db.db.get(), ids[i].id_, strs[i]);
+    }
+
+    template <typename DATABASE_T, typename STORAGE_T, class HashPolicy>
+    void string_id<DATABASE_T, STORAGE_T, HashPolicy>::make_batch(in_database db, std::span<const string_info> strs,
+                                                                 std::span<string_id> ids,
+                                                                 std::span<insert_status> status)
     {
-        return db_.lookup(id_);
+        assert(strs.size() == ids.size() && strs.size() == status.size());
+        std::vector<STORAGE_T> hashes(strs.size());
+        for (std::size_t i = 0u; i != strs.size(); ++i)
+            hashes[i] = HashPolicy::template fast_hash<STORAGE_T>(strs[i].string, strs[i].length);
+
+        db.db.get().DATABASE_T::insert_batch(hashes, strs, status);
+        for (std::size_t i = 0u; i != strs.size(); ++i)
+        {
+            static_cast<database_ref&>(ids[i]) = db.db;
+            ids[i].id_ = hashes[i];
+        #if STRID_DEBUG
+            if (status[i] != insert_status::collision)
+                detail::register_debug_string(ids[i].id_, ids[i].string());
+        #endif
+        }
+    }
+
+    template <typename DATABASE_T, typename STORAGE_T, class HashPolicy>
+    void string_id<DATABASE_T, STORAGE_T, HashPolicy>::make_batch(const string_id& prefix,
+                                                                 std::span<const string_info> strs,
+                                                                 std::span<string_id> ids)
+    {
+        std::vector<insert_status> status(strs.size());
+        make_batch(prefix, strs, ids, status);
+        for (std::size_t i = 0u; i != strs.size(); ++i)
+            if (status[i] == insert_status::collision)
+                handle_collision(prefix.database(), ids[i].id_, strs[i]);
+    }
+
+    template <typename DATABASE_T, typename STORAGE_T, class HashPolicy>
+    void string_id<DATABASE_T, STORAGE_T, HashPolicy>::make_batch(const string_id& prefix,
+                                                                 std::span<const string_info> strs,
+                                                                 std::span<string_id> ids,
+                                                                 std::span<insert_status> status)
+    {
+        assert(strs.size() == ids.size() && strs.size() == status.size());
+        std::vector<STORAGE_T> hashes(strs.size());
+        for (std::size_t i = 0u; i != strs.size(); ++i)
+            hashes[i] = hash_prefix(prefix, strs[i]);
+
+        prefix.database().DATABASE_T::insert_prefix_batch(hashes, prefix.id_, strs, status);
+        for (std::size_t i = 0u; i != strs.size(); ++i)
+        {
+            static_cast<database_ref&>(ids[i]) = prefix;
+            ids[i].id_ = hashes[i];
+        #if STRID_DEBUG
+            if (status[i] != insert_status::collision)
+                detail::register_debug_string(ids[i].id_, ids[i].string());
+        #endif
+        }
+    }
+
+    template <typename DATABASE_T, typename STORAGE_T, class HashPolicy>
+    STORAGE_T string_id<DATABASE_T, STORAGE_T, HashPolicy>::hash_prefix(const string_id& prefix, string_info str)
+    {
+        if constexpr (HashPolicy::is_incremental)
+            return HashPolicy::template fast_append<STORAGE_T>(prefix.id_, str.string, str.length);
+        else
+        {
+            // a placeholder would give all ids with the same suffix the same hash
+            static_assert(detail::database_stores_strings<DATABASE_T>::value,
+                          "ids with a prefix need an incremental hash policy if the database doesn't store strings");
+            // needs the string of the prefix
+            std::string full(prefix.string_view());
+            full.append(str.string, str.length);
+            return HashPolicy::template fast_hash<STORAGE_T>(full.c_str(), full.size());
+        }
+    }
+
+    template <typename DATABASE_T, typename STORAGE_T, class HashPolicy>
+    const char* string_id<DATABASE_T, STORAGE_T, HashPolicy>::string() const FOONATHAN_NOEXCEPT
+    {
+        return database().DATABASE_T::lookup(id_);
+    }
+
+    template <typename DATABASE_T, typename STORAGE_T, class HashPolicy>
+    std::string_view string_id<DATABASE_T, STORAGE_T, HashPolicy>::string_view() const FOONATHAN_NOEXCEPT
+    {
+        return database().DATABASE_T::lookup_view(id_);
     }
     
+    /// \cond impl
+    namespace detail
+    {
+        // the result of the literal operator
+        template <fixed_string Str>
+        struct string_id_literal
+        {
+            template <typename DATABASE_T, typename STORAGE_T, class HashPolicy>
+            operator string_id<DATABASE_T, STORAGE_T, HashPolicy>() const
+            {
+                return string_id<DATABASE_T, STORAGE_T, HashPolicy>::template literal<Str>();
+            }
+        };
+    } // namespace detail
+    /// \endcond
+
     namespace literals
     {
         /// \brief Same as the literal version, additional replacement if not supported.
-        template<typename STORAGE_T>
+        /// \detail It also allows hashing with a different policy than \ref default_hash_policy.
+        template<typename STORAGE_T, class HashPolicy = default_hash_policy>
         FOONATHAN_CONSTEXPR_FNC STORAGE_T id(const char* str)
         {
-            return detail::sid_hash(str);
+            return HashPolicy::template hash<STORAGE_T>(str, std::char_traits<char>::length(str));
         }
         
         /// \brief A useful literal to hash a string.
         /// \detail Since this function does not check for collisions only use it to compare a \ref string_id.<br>
         /// It is also useful in places where a compile-time constant is needed.
     #if FOONATHAN_STRING_ID_HAS_LITERAL
-        FOONATHAN_CONSTEXPR_FNC uint32_t operator""_id(const char* str, std::size_t)
+        FOONATHAN_CONSTEXPR_FNC uint32_t operator""_id(const char* str, std::size_t length)
+        {
+            return default_hash_policy::hash<uint32_t>(str, length);
+        }
+
+        FOONATHAN_CONSTEXPR_FNC uint64_t operator""_id64(const char* str, std::size_t length)
         {
-            uint32_t res;
-            detail::sid_hash(str, res);
-            return res;
+            return default_hash_policy::hash<uint64_t>(str, length);
         }
 
-        FOONATHAN_CONSTEXPR_FNC uint64_t operator""_id64(const char* str, std::size_t)
+        /// \brief A literal that converts to any \ref string_id type.
+        /// \detail \c string_id<...> name = "player"_sid; is the same as \c string_id<...>::literal<"player">(),
+        /// so the string is hashed at compile-time and only inserted on the first conversion.
+        template <fixed_string Str>
+        FOONATHAN_CONSTEXPR_FNC detail::string_id_literal<Str> operator""_sid() FOONATHAN_NOEXCEPT
         {
-            uint64_t res;
-            detail::sid_hash(str, res);
-            return res;
+            return {};
         }
     #endif
     } // namespace literals
@@ -221,10 +670,10 @@ namespace foonathan { namespace string_id
 namespace std
 {
     /// \brief \c std::hash support for \ref string_id.
-    template <typename DATABASE_T>
-    struct hash<foonathan::string_id::string_id<DATABASE_T>>
+    template <typename DATABASE_T, typename STORAGE_T, class HashPolicy>
+    struct hash<foonathan::string_id::string_id<DATABASE_T, STORAGE_T, HashPolicy>>
     {
-        typedef foonathan::string_id::string_id<DATABASE_T> argument_type;
+        typedef foonathan::string_id::string_id<DATABASE_T, STORAGE_T, HashPolicy> argument_type;
         typedef size_t result_type;        
  
         result_type operator()(const argument_type &arg) const FOONATHAN_NOEXCEPT
@@ -0,0 +1,112 @@
+// Copyright (C) 2014-2015 Jonathan Müller <jonathanmueller.dev@gmail.com>
+// This file is subject to the license terms in the LICENSE file
+// found in the top-level directory of this distribution.
+
+#include "arena.hpp"
+
+#include <cassert>
+#include <cstdint>
+#include <new>
+#include <utility>
+
+namespace sid = foonathan::string_id;
+
+struct sid::memory_arena::block
+{
+    block* prev;
+};
+
+sid::memory_arena::memory_arena(std::size_t block_size) FOONATHAN_NOEXCEPT
+: head_(nullptr), cur_(nullptr), end_(nullptr), block_size_(block_size), no_blocks_(0u)
+{}
+
+sid::memory_arena::memory_arena(memory_arena&& other) FOONATHAN_NOEXCEPT
+: head_(other.head_), cur_(other.cur_), end_(other.end_),
+  block_size_(other.block_size_), no_blocks_(other.no_blocks_)
+{
+    other.head_ = nullptr;
+    other.cur_ = other.end_ = nullptr;
+    other.no_blocks_ = 0u;
+}
+
+sid::memory_arena::~memory_arena() FOONATHAN_NOEXCEPT
+{
+    release();
+}
+
+sid::memory_arena& sid::memory_arena::operator=(memory_arena&& other) FOONATHAN_NOEXCEPT
+{
+    release();
+    head_       = std::exchange(other.head_, nullptr);
+    cur_        = std::exchange(other.cur_, nullptr);
+    end_        = std::exchange(other.end_, nullptr);
+    block_size_ = other.block_size_;
+    no_blocks_  = std::exchange(other.no_blocks_, 0u);
+    return *this;
+}
+
+void* sid::memory_arena::allocate(std::size_t size, std::size_t alignment)
+{
+    assert(alignment != 0u && (alignment & (alignment - 1)) == 0u
+           && alignment <= alignof(std::max_align_t) && "invalid alignment");
+    auto misaligned = reinterpret_cast<std::uintptr_t>(cur_) & (alignment - 1);
+    auto offset     = misaligned ? alignment - misaligned : 0u;
+    if (cur_ && std::size_t(end_ - cur_) >= offset + size)
+    {
+        auto res = cur_ + offset;
+        cur_     = res + size;
+        return res;
+    }
+
+    auto oversized = size > block_size_ / 4;
+    auto memory    = allocate_block(oversized ? size : block_size_);
+    if (oversized && head_->prev)
+    {
+        // keep bumping in the current block, the new one is linked behind it
+        auto b      = head_;
+        head_       = b->prev;
+        b->prev     = head_->prev;
+        head_->prev = b;
+        return memory;
+    }
+
+    cur_ = memory + size;
+    end_ = memory + (oversized ? size : block_size_);
+    return memory;
+}
+
+void sid::memory_arena::reserve(std::size_t size)
+{
+    if (cur_ && capacity() >= size)
+        return;
+
+    // the rest of the current block is wasted
+    auto block_size = size > block_size_ ? size : block_size_;
+    cur_ = allocate_block(block_size);
+    end_ = cur_ + block_size;
+}
+
+// allocates a new block of given size and makes it the head
+char* sid::memory_arena::allocate_block(std::size_t size)
+{
+    // the header is padded to the maximum alignment, so the block memory is always aligned
+    static FOONATHAN_CONSTEXPR auto header_size
+        = (sizeof(block) + alignof(std::max_align_t) - 1) / alignof(std::max_align_t) * alignof(std::max_align_t);
+    auto b = static_cast<block*>(::operator new(header_size + size));
+    ++no_blocks_;
+    b->prev = head_;
+    head_   = b;
+    return static_cast<char*>(static_cast<void*>(b)) + header_size;
+}
+
+void sid::memory_arena::release() FOONATHAN_NOEXCEPT
+{
+    while (head_)
+    {
+        auto prev = head_->prev;
+        ::operator delete(head_);
+        head_ = prev;
+    }
+    cur_ = end_ = nullptr;
+    no_blocks_  = 0u;
+}
@@ -3,16 +3,43 @@
 // found in the top-level directory of this distribution.
 
 #include "error.hpp"
+#include "database.hpp"
+#include "registered_database.hpp"
 
 #include <sstream>
 
 namespace sid = foonathan::string_id;
 
-const char* sid::generation_error::what() const FOONATHAN_NOEXCEPT try
+sid::generation_error::generation_error(const char* generator_name) FOONATHAN_NOEXCEPT
+{
+    detail::copy_truncated(name_, sizeof(name_), generator_name);
+    std::snprintf(what_, sizeof(what_),
+                  "foonathan::string_id::generation_error: Generator \"%s\" was unable to generate new string id.", name_);
+}
+
+const char* sid::generation_error::what() const FOONATHAN_NOEXCEPT
+{
+    return what_;
+}
+
+sid::string_length_error::string_length_error(std::size_t length, std::size_t max_length) FOONATHAN_NOEXCEPT
+: length_(length), max_length_(max_length)
+{
+    std::snprintf(what_, sizeof(what_),
+                  "foonathan::string_id::string_length_error: String of length %zu is longer than %zu.", length_,
+                  max_length_);
+}
+
+const char* sid::string_length_error::what() const FOONATHAN_NOEXCEPT
+{
+    return what_;
+}
+
+const char* sid::database_registry_error::what() const FOONATHAN_NOEXCEPT try
 {
     return what_.c_str();
 }
 catch (...)
 {
-    return "foonathan::string_id::generation_error: unable to generate new string id.";
+    return "foonathan::string_id::database_registry_error: too many databases registered.";
 }
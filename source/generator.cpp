@@ -27,3 +27,37 @@ sid::character_table sid::character_table::alpha() FOONATHAN_NOEXCEPT
 {
     return {table, sizeof(table) - 1 - 10};
 }
+
+namespace
+{
+    std::uint64_t splitmix64(std::uint64_t& x) FOONATHAN_NOEXCEPT
+    {
+        auto z = (x += 0x9E3779B97F4A7C15u);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9u;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBu;
+        return z ^ (z >> 31);
+    }
+}
+
+sid::xoshiro256ss::xoshiro256ss(std::uint64_t seed) FOONATHAN_NOEXCEPT
+{
+    for (auto& s : state_)
+        s = splitmix64(seed);
+}
+
+void sid::xoshiro256ss::jump() FOONATHAN_NOEXCEPT
+{
+    static FOONATHAN_CONSTEXPR std::uint64_t jump_table[] = {0x180EC6D33CFD0ABAu, 0xD5A61266F0C9392Cu,
+                                                             0xA9582618E03FC9AAu, 0x39ABDC4529B1661Cu};
+    std::uint64_t s[4] = {};
+    for (auto j : jump_table)
+        for (auto b = 0; b != 64; ++b)
+        {
+            if (j & (std::uint64_t(1u) << b))
+                for (auto i = 0; i != 4; ++i)
+                    s[i] ^= state_[i];
+            (*this)();
+        }
+    for (auto i = 0; i != 4; ++i)
+        state_[i] = s[i];
+}
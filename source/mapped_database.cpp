@@ -0,0 +1,214 @@
+// Copyright (C) 2014-2015 Jonathan Müller <jonathanmueller.dev@gmail.com>
+// This file is subject to the license terms in the LICENSE file
+// found in the top-level directory of this distribution.
+
+#include "mapped_database.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <utility>
+
+#if defined(_WIN32)
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+namespace sid = foonathan::string_id;
+
+const char* sid::snapshot_error::what() const FOONATHAN_NOEXCEPT try
+{
+    return what_.c_str();
+}
+catch (...)
+{
+    return "foonathan::string_id::snapshot_error: unable to load snapshot.";
+}
+
+sid::mapped_file::mapped_file() FOONATHAN_NOEXCEPT
+: data_(nullptr), size_(0u) {}
+
+#if defined(_WIN32)
+sid::mapped_file::mapped_file(const char* path)
+: mapped_file()
+{
+    auto file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        throw snapshot_error(path, "unable to open file");
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size))
+    {
+        CloseHandle(file);
+        throw snapshot_error(path, "unable to get file size");
+    }
+    size_ = static_cast<std::size_t>(size.QuadPart);
+    if (size_ == 0u)
+    {
+        CloseHandle(file);
+        return;
+    }
+
+    // the view keeps the mapping and the file alive
+    auto mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (!mapping)
+        throw snapshot_error(path, "unable to map file");
+    data_ = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    CloseHandle(mapping);
+    if (!data_)
+        throw snapshot_error(path, "unable to map file");
+}
+
+void sid::mapped_file::unmap() FOONATHAN_NOEXCEPT
+{
+    if (data_)
+        UnmapViewOfFile(data_);
+}
+#else
+sid::mapped_file::mapped_file(const char* path)
+: mapped_file()
+{
+    auto fd = ::open(path, O_RDONLY);
+    if (fd == -1)
+        throw snapshot_error(path, "unable to open file");
+
+    struct stat info;
+    if (::fstat(fd, &info) == -1)
+    {
+        ::close(fd);
+        throw snapshot_error(path, "unable to get file size");
+    }
+    size_ = static_cast<std::size_t>(info.st_size);
+    if (size_ == 0u)
+    {
+        ::close(fd);
+        return;
+    }
+
+    // the mapping stays valid after closing the file
+    auto mem = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mem == MAP_FAILED)
+        throw snapshot_error(path, "unable to map file");
+    data_ = static_cast<const char*>(mem);
+}
+
+void sid::mapped_file::unmap() FOONATHAN_NOEXCEPT
+{
+    if (data_)
+        ::munmap(const_cast<char*>(data_), size_);
+}
+#endif
+
+sid::mapped_file::mapped_file(mapped_file&& other) FOONATHAN_NOEXCEPT
+: data_(std::exchange(other.data_, nullptr)), size_(std::exchange(other.size_, 0u)) {}
+
+sid::mapped_file::~mapped_file() FOONATHAN_NOEXCEPT
+{
+    unmap();
+}
+
+sid::mapped_file& sid::mapped_file::operator=(mapped_file&& other) FOONATHAN_NOEXCEPT
+{
+    unmap();
+    data_ = std::exchange(other.data_, nullptr);
+    size_ = std::exchange(other.size_, 0u);
+    return *this;
+}
+
+const sid::detail::snapshot_header& sid::detail::check_snapshot(const mapped_file& file, const char* path,
+                                                               std::size_t storage_size)
+{
+    if (file.size() < sizeof(snapshot_header))
+        throw snapshot_error(path, "file too small");
+
+    auto& header = *reinterpret_cast<const snapshot_header*>(file.data());
+    if (std::memcmp(header.magic, snapshot_magic, sizeof(snapshot_magic)) != 0)
+        throw snapshot_error(path, "not a snapshot file");
+    else if (header.version != snapshot_version)
+        throw snapshot_error(path, "unsupported version");
+    else if (header.storage_size != storage_size)
+        throw snapshot_error(path, "hash size does not match the database");
+
+    // checked in steps to avoid overflow
+    auto max_strings = (file.size() - sizeof(snapshot_header)) / (storage_size + sizeof(std::uint64_t));
+    if (header.no_strings > max_strings
+        || snapshot_blob_pos(header.no_strings, storage_size) > file.size()
+        || header.blob_size != file.size() - snapshot_blob_pos(header.no_strings, storage_size))
+        throw snapshot_error(path, "file size does not match the header");
+    else if (header.blob_size && file.data()[file.size() - 1] != '\0')
+        throw snapshot_error(path, "strings are not null-terminated");
+    else if (header.no_strings && !header.blob_size)
+        throw snapshot_error(path, "strings are missing");
+
+    // lookups use binary search over the hashes and the offsets as lengths
+    auto hashes  = file.data() + sizeof(snapshot_header);
+    auto offsets = file.data() + snapshot_offsets_pos(header.no_strings, storage_size);
+    auto blob    = file.data() + snapshot_blob_pos(header.no_strings, storage_size);
+    auto read_hash = [&](std::size_t i)
+    {
+        std::uint64_t hash = 0u;
+        if (storage_size == sizeof(std::uint32_t))
+        {
+            std::uint32_t h;
+            std::memcpy(&h, hashes + i * storage_size, sizeof(h));
+            hash = h;
+        }
+        else
+            std::memcpy(&hash, hashes + i * storage_size, sizeof(hash));
+        return hash;
+    };
+    auto read_offset = [&](std::size_t i)
+    {
+        std::uint64_t offset;
+        std::memcpy(&offset, offsets + i * sizeof(offset), sizeof(offset));
+        return offset;
+    };
+
+    for (std::size_t i = 0u; i != header.no_strings; ++i)
+    {
+        auto offset = read_offset(i);
+        auto next   = i + 1u == header.no_strings ? header.blob_size : read_offset(i + 1u);
+        if ((i == 0u && offset != 0u) || next <= offset || next > header.blob_size)
+            throw snapshot_error(path, "string offsets are not ascending");
+        else if (blob[next - 1u] != '\0')
+            throw snapshot_error(path, "strings are not null-terminated");
+        else if (i != 0u && read_hash(i) <= read_hash(i - 1u))
+            throw snapshot_error(path, "hashes are not sorted");
+    }
+    return header;
+}
+
+void sid::detail::write_snapshot(const char* path, std::size_t storage_size,
+                                 const void* hashes, std::size_t no_strings,
+                                 const std::uint64_t* offsets, const std::string& blob)
+{
+    snapshot_header header;
+    std::memcpy(header.magic, snapshot_magic, sizeof(snapshot_magic));
+    header.version      = snapshot_version;
+    header.storage_size = static_cast<std::uint32_t>(storage_size);
+    header.no_strings   = no_strings;
+    header.blob_size    = blob.size();
+
+    std::ofstream out(path, std::ios_base::binary | std::ios_base::trunc);
+    if (!out)
+        throw snapshot_error(path, "unable to open file for writing");
+
+    static const char padding[8] = {};
+    auto hashes_size = no_strings * storage_size;
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(static_cast<const char*>(hashes), static_cast<std::streamsize>(hashes_size));
+    out.write(padding, static_cast<std::streamsize>(snapshot_offsets_pos(no_strings, storage_size)
+                                                    - sizeof(header) - hashes_size));
+    out.write(reinterpret_cast<const char*>(offsets), static_cast<std::streamsize>(no_strings * sizeof(std::uint64_t)));
+    out.write(blob.data(), static_cast<std::streamsize>(blob.size()));
+    if (!out.flush())
+        throw snapshot_error(path, "unable to write file");
+}
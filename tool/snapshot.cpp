@@ -0,0 +1,69 @@
+// Copyright (C) 2014-2015 Jonathan Müller <jonathanmueller.dev@gmail.com>
+// This file is subject to the license terms in the LICENSE file
+// found in the top-level directory of this distribution.
+
+// creates a snapshot file for mapped_database
+// reads one string per line and writes the snapshot using the default hash policy and all cores
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "build_database.hpp" // for write_snapshot
+
+namespace sid = foonathan::string_id;
+
+namespace
+{
+    void print_usage(const char* name)
+    {
+        std::cerr << "Usage: " << name << " [--64] <input> <output>\n"
+                  << "Creates a snapshot of the strings in <input>, one per line.\n"
+                  << "  --64  use 64 bit hashes instead of 32 bit\n";
+    }
+}
+
+int main(int argc, char* argv[]) try
+{
+    auto use_64 = argc == 4 && std::strcmp(argv[1], "--64") == 0;
+    if (argc != (use_64 ? 4 : 3))
+    {
+        print_usage(argv[0]);
+        return 1;
+    }
+    auto input = argv[use_64 ? 2 : 1], output = argv[use_64 ? 3 : 2];
+
+    std::ifstream in(input);
+    if (!in)
+    {
+        std::cerr << "Unable to open \"" << input << "\"\n";
+        return 1;
+    }
+
+    std::vector<std::string> lines;
+    for (std::string line; std::getline(in, line);)
+    {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        if (!line.empty())
+            lines.push_back(std::move(line));
+    }
+
+    std::vector<sid::string_info> strs;
+    strs.reserve(lines.size());
+    for (auto& line : lines)
+        strs.emplace_back(line.c_str(), line.size());
+
+    sid::thread_executor exec;
+    auto no_written = use_64 ? sid::write_snapshot<std::uint64_t>(output, strs, exec)
+                             : sid::write_snapshot<std::uint32_t>(output, strs, exec);
+    std::cout << "Wrote " << no_written << " strings to \"" << output << "\"\n";
+}
+catch (const sid::error& ex)
+{
+    std::cerr << ex.what() << '\n';
+    return 1;
+}